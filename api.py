@@ -23,18 +23,79 @@ botId = accountInfo.json()["id"]
 def fjsonPrint(unformatJson):
     print(json.dumps(unformatJson, indent=4))
 
-def getBotMove(listOfMoves):
-    print("Generating bot move")
-    engineThinking = subprocess.run(["./lichessEngine"] + listOfMoves, stdout=subprocess.PIPE)
+print("Starting engine")
+# The engine is kept running between moves, so its hash table and game stay warm
+engine = subprocess.Popen(["./lichessEngine"], stdin=subprocess.PIPE, stdout=subprocess.PIPE, universal_newlines=True, bufsize=1)
+
+def engineSend(command):
+    engine.stdin.write(command + "\n")
+    engine.stdin.flush()
+
+def engineWaitFor(prefix):
+    for line in engine.stdout:
+        if line.startswith(prefix):
+            return line.strip()
+    raise RuntimeError("Engine exited")
+
+engineSend("uci")
+engineWaitFor("uciok")
+engineSend("isready")
+engineWaitFor("readyok")
+
+# Moves of the position the engine is pondering on (ending with the expected opponent move), or None
+ponderedMoves = None
+
+def clockOptions(gameState):
+    # Clock times from lichess are in milliseconds
+    clock = ""
+    for option, key in (("wtime", "wtime"), ("btime", "btime"), ("winc", "winc"), ("binc", "binc")):
+        if key in gameState:
+            clock += " {} {}".format(option, gameState[key])
+    return clock
+
+def engineBestMove():
     #format engine output
-    moveUCI = engineThinking.stdout.decode("utf-8")
-    return moveUCI
+    bestMoveLine = engineWaitFor("bestmove").split()
+    ponderMove = bestMoveLine[3] if len(bestMoveLine) > 3 and bestMoveLine[2] == "ponder" else None
+    return bestMoveLine[1], ponderMove
+
+def stopPondering():
+    global ponderedMoves
+    if ponderedMoves != None:
+        ponderedMoves = None
+        engineSend("stop")
+        engineBestMove() # The search on a move that wasn't played is thrown away
+
+def startPondering(listOfMoves, gameState, botMove, ponderMove):
+    global ponderedMoves
+    if ponderMove == None:
+        return
+    print("Pondering on {}".format(ponderMove))
+    ponderedMoves = listOfMoves + [botMove, ponderMove]
+    engineSend("position startpos moves " + " ".join(ponderedMoves))
+    engineSend("go ponder" + clockOptions(gameState))
+
+def getBotMove(listOfMoves, gameState):
+    global ponderedMoves
+    print("Generating bot move")
+    if ponderedMoves == listOfMoves:
+        # The opponent played the expected move, the search keeps going with our clock running
+        print("Ponderhit")
+        ponderedMoves = None
+        engineSend("ponderhit")
+        return engineBestMove()
+    stopPondering()
+    engineSend("position startpos moves " + " ".join(listOfMoves))
+    engineSend("go" + clockOptions(gameState))
+    return engineBestMove()
 
 def handleGameState(gameId, gameState):
     if gameState["status"] != "started":
+        stopPondering()
         return True
     
     botMove = None
+    ponderMove = None
 
     listOfMoves = gameState["moves"].split()
     if len(listOfMoves) % 2 == 0:
@@ -42,12 +103,12 @@ def handleGameState(gameId, gameState):
         if botIsPlayingWhite:
             if len(listOfMoves) > 1:
                 print("Opponent has moved {}".format(listOfMoves[-1]))
-            botMove = getBotMove(listOfMoves)            
+            botMove, ponderMove = getBotMove(listOfMoves, gameState)            
     else:
         # black's move
         if not botIsPlayingWhite:
             print("Opponent has moved {}".format(listOfMoves[-1]))
-            botMove = getBotMove(listOfMoves)            
+            botMove, ponderMove = getBotMove(listOfMoves, gameState)            
     
     if botMove != None:
         makeMoveResponse = None
@@ -57,6 +118,7 @@ def handleGameState(gameId, gameState):
             makeMoveResponse = requests.post(dest("/bot/game/{}/move/{}".format(gameId, botMove)), headers=apiHeader)
             if makeMoveResponse != None and makeMoveResponse.status_code == 200:
                 print("Move successful")
+                startPondering(listOfMoves, gameState, botMove, ponderMove)
                 break
         else:
             print("Move failed - resigning")
@@ -72,6 +134,10 @@ def gameStart(jsonEvent):
     global botId
     gameId = jsonEvent["game"]["id"]
     print("Starting game with id {}".format(gameId))
+    stopPondering()
+    engineSend("ucinewgame")
+    engineSend("isready")
+    engineWaitFor("readyok")
     print("Opening game stream")
     incomingGameData = None
     for _ in range(5): 
@@ -0,0 +1,63 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define AI_MAX_PLY 4
+
+#include "include/chess.hpp"
+#include "include/ai.hpp"
+
+int main(int argc, const char* argv[]) {
+	chess::ai::bot nomalahCustomDesignedBot {
+		chess::ai::botWeights {
+			.moveOrdering = {
+				.pieceValues         = { 0, 100, 300, 320, 500, 900, 0, 0, 0, 100, 300, 320, 500, 900, 0 },
+				.hashMove            = 10000,
+				.notHashMove         = 0,
+				.promotionMultiplier = 5,
+				.captureMultiplier   = 2,
+				.kingsideCastling    = 100,
+				.queensideCastling   = 100,
+				.enPassant           = 0,
+				.pawnDoublePush      = 0,
+				.defaultMove         = -100 },
+			.evaluate = { .pieceValues = { 0, 100, 300, 320, 500, 900, 0, 0, 0, 100, 300, 320, 500, 900, 0 } } }
+	};
+
+	const std::vector<std::string> benchPositions {
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+		"r1bqkbnr/1ppp1ppp/p1n5/1B2p3/4P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 0 4",
+		"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+		"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"
+	};
+
+	// Usage: bench [max threads] [depth] [network file]
+	const size_t maxThreads { argc > 1 ? std::stoull(argv[1]) : std::max<size_t>(std::thread::hardware_concurrency(), 1) };
+	const chess::ai::searchLimits limits { .depth = argc > 2 ? std::clamp(std::stoi(argv[2]), 1, chess::ai::maxSearchDepth) : chess::ai::searchPly };
+	if (argc > 3 && !(nomalahCustomDesignedBot.setNetwork(chess::ai::nnue::load(argv[3])), nomalahCustomDesignedBot.network())) {
+		std::cout << "\u001b[31m[Network]:[" << argv[3] << "] could not be loaded\u001b[0m" << std::endl;
+		return 1;
+	}
+	const std::string evaluationName { nomalahCustomDesignedBot.network() ? std::string { "nnue " } + chess::ai::nnue::name(chess::ai::nnue::activeBackend) : "piece-square" };
+
+	double singleThreadRate { 0 };
+	for (size_t threadCount { 1 }; threadCount <= maxThreads; threadCount = (threadCount * 2 > maxThreads && threadCount != maxThreads) ? maxThreads : threadCount * 2) {
+		chess::ai::transpositionTable TT { chess::ai::defaultHashMegabytes };
+		size_t totalNodes { 0 };
+		auto startTime = std::chrono::high_resolution_clock::now();
+		for (const auto& fen : benchPositions) {
+			totalNodes += chess::ai::search(chess::game { fen }, nomalahCustomDesignedBot, TT, threadCount, limits).nodes;
+		}
+		auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+		const double rate { static_cast<double>(totalNodes) * 1000 / std::max<decltype(duration)>(duration, 1) };
+		if (threadCount == 1)
+			singleThreadRate = rate;
+		std::cout << "\u001b[34m[Threads]:[" << threadCount << "] [Depth]:[" << limits.depth << "] [Eval]:[" << evaluationName << "] [Nodes]:[" << totalNodes << "] [Duration]:[" << duration / 1000 << "ms] [kn/s]:[" << static_cast<size_t>(rate) << "] [Speedup]:[" << rate / singleThreadRate << "x]\u001b[0m" << std::endl;
+	}
+	return 0;
+}
@@ -2,17 +2,19 @@
 #define NMLH_CHESS_AI_H
 
 #include "chess.hpp"
+#include "ai_nnue.hpp"
 #include <algorithm>
 #include <limits>
 #include <cmath>
 #include <memory>
-
-#define SWAP(a, b)       \
-	do {                 \
-		auto _c { (a) }; \
-		(a) = (b);       \
-		(b) = _c;        \
-	} while (0)
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <numeric>
+#include <functional>
+#include <chrono>
+#include <bit>
+#include <cstdint>
 
 namespace chess::ai {
 #ifdef AI_MAX_PLY
@@ -20,50 +22,124 @@ namespace chess::ai {
 #else
 	constexpr int searchPly = 5;
 #endif
-	constexpr int maxQSearchPly = -40;
-	static_assert(searchPly - maxQSearchPly < ((1024 - sizeof(moveData*)) / sizeof(moveData)), "Ply Depth Too Large");
+	constexpr int maxSearchDepth = 64;    // Deepest iteration of a search limited by time
+	constexpr int maxQSearchPly = -40;    // Quiescence plies below the horizon
+#ifdef AI_HASH_MB
+	constexpr size_t defaultHashMegabytes = AI_HASH_MB;
+#else
+	constexpr size_t defaultHashMegabytes = 64;
+#endif
+#ifdef AI_THREADS
+	constexpr size_t defaultThreads = AI_THREADS;
+#else
+	constexpr size_t defaultThreads = 1;
+#endif
+	static_assert(maxSearchDepth - maxQSearchPly < ((1024 - sizeof(moveData*)) / sizeof(moveData)), "Ply Depth Too Large");
+	constexpr long long moveOverhead { 30 };         // Milliseconds kept back for communication with the gui/server
+	constexpr int defaultMovesToGo { 30 };           // Moves the remaining time is split over when the time control doesn't say
+	constexpr size_t timeCheckInterval { 2048 };    // Nodes between checks of the clock
+	constexpr int aspirationWindow { 30 };          // Half width of the first window around the previous iteration's score
+	constexpr int aspirationMinDepth { 4 };         // Shallower iterations are unstable, and cheap enough to search with the full window
+	constexpr int nullMoveMinDepth { 3 };           // Below this the reduced search after a null move would go straight to quiescence
+	constexpr int lateMoveMinDepth { 3 };
+	constexpr size_t lateMoveMinMoves { 3 };        // The first moves of a node are the most likely to be best, and are never reduced
+
+	// Plies a late quiet move is reduced by, indexed by the remaining depth and the number of the move in the node
+	inline const std::array<std::array<int, 64>, 64> lateMoveReductions = []() {
+		std::array<std::array<int, 64>, 64> result {};
+		for (size_t depth { 1 }; depth < 64; depth++) {
+			for (size_t moveNumber { 1 }; moveNumber < 64; moveNumber++) {
+				result[depth][moveNumber] = static_cast<int>(0.75 + std::log(depth) * std::log(moveNumber) / 2.25);
+			}
+		}
+		return result;
+	}();
 
 	inline bool isACapture(chess::u16 flag) {
 		return ((flag & 0xF000) == 0x1000) || ((flag & 0xF000) == 0x6000) || ((flag & 0xF000) == 0x7000);
 	}
 
-	namespace {
-		template <size_t sz>
-		constexpr bool isPowerOfTwo() {
-			// constexpr popcount
-			size_t num { sz };
-			unsigned int numOfOnes = 0;
-			while (num && numOfOnes <= 1) {
-				numOfOnes += num & 1;
-				num >>= 1;
-			}
-			return numOfOnes == 1;
-		}
-	};    // namespace
+	// Neither a capture nor a promotion
+	[[nodiscard]] inline bool isQuiet(const chess::moveData move) noexcept {
+		return !isACapture(move.flags) && move.promotionPiece() == 0;
+	}
+
+	[[nodiscard]] inline bool sideToMoveInCheck(const chess::position& toTest) noexcept {
+		return toTest.turn() == chess::piece::white ? toTest.inCheck<chess::piece::white>() : toTest.inCheck<chess::piece::black>();
+	}
+
+	// The moves the search tries in a position, pseudo-legal when built with CHESS_PSEUDO_LEGAL
+	[[nodiscard]] inline chess::moveSlice searchMoves(chess::moveStack::frame& moveBuffer, const chess::position& toSearch, const chess::moveGenType genType = chess::moveGenType::all) noexcept {
+		if constexpr (chess::pseudoLegalGeneration)
+			return moveBuffer.generatePseudoLegal(toSearch, genType);
+		else
+			return moveBuffer.generate(toSearch, genType);
+	}
+
+	// Whether a move from searchMoves can be played, only checked just before it would be
+	[[nodiscard]] inline bool playable(const chess::position& toSearch, const chess::moveData searchMove) noexcept {
+		return !chess::pseudoLegalGeneration || toSearch.isLegal(searchMove);
+	}
+
+	constexpr int mateValue { 20000 };
+	constexpr int drawValue { 0 };    // The same for either side to move, so it doesn't flip sign from ply to ply
+	constexpr int mateThreshold { mateValue - 256 };    // Any evaluation beyond this is a forced mate
 
-	template <size_t sz>
 	class transpositionTable {
-		static_assert(isPowerOfTwo<sz>(), "Transposition table requires a power of two size");
 		// https://github.com/SebLague/Chess-AI/blob/main/Assets/Scripts/Core/TranspositionTable.cs
-		// 24 bytes
 	public:
+		// key (16) | age (6) | nodeType (2) | depth (8) | posEval (16) | move (16)
+		// Only the top 16 bits of the key are kept, the low bits already picked the bucket.
+		// The move keeps its squares and promotion, its flags come back from the position it is played in.
+		struct entryData {
+			u64 data;
+
+			[[nodiscard]] constexpr chess::u16 packedMove() const noexcept { return static_cast<chess::u16>(data); }
+			[[nodiscard]] constexpr int posEval() const noexcept { return static_cast<short>(data >> 16); }
+			[[nodiscard]] constexpr int depth() const noexcept { return static_cast<signed char>(data >> 32); }
+			[[nodiscard]] constexpr int nodeType() const noexcept { return static_cast<int>((data >> 40) & 0x3); }
+			[[nodiscard]] constexpr chess::u8 age() const noexcept { return static_cast<chess::u8>((data >> 42) & ageMask); }
+			[[nodiscard]] constexpr chess::u16 keyCheck() const noexcept { return static_cast<chess::u16>(data >> 48); }
+
+			// origin (6) | destination (6) | promotion piece type (4)
+			[[nodiscard]] static constexpr chess::u16 packMove(const chess::moveData move) noexcept {
+				return static_cast<chess::u16>(move.originIndex | move.destinationIndex << 6 | chess::util::getPieceOf(move.promotionPiece()) << 12);
+			}
+			[[nodiscard]] static constexpr chess::u16 keyCheckOf(const u64 key) noexcept { return static_cast<chess::u16>(key >> 48); }
+			[[nodiscard]] static constexpr entryData pack(const u64 key, const chess::u16 packedMove, const int posEval, const int depth, const int nodeType, const chess::u8 age) noexcept {
+				return { static_cast<u64>(packedMove) |
+					     static_cast<u64>(static_cast<chess::u16>(std::clamp<int>(posEval, std::numeric_limits<short>::min(), std::numeric_limits<short>::max()))) << 16 |
+					     static_cast<u64>(static_cast<chess::u8>(std::clamp<int>(depth, std::numeric_limits<signed char>::min(), std::numeric_limits<signed char>::max()))) << 32 |
+					     static_cast<u64>(nodeType & 0x3) << 40 |
+					     static_cast<u64>(age & ageMask) << 42 |
+					     static_cast<u64>(keyCheckOf(key)) << 48 };
+			}
+		};
+
+		// 8 bytes, eight entries fill one 64 byte cache line
+		// Every entry is read and written as one word, so two threads writing at once can't tear it
 		struct tableEntry {
-			u64 key;
-			chess::moveData move;
-			int posEval;
-			int depth;
-			int nodeType;
+			std::atomic<u64> data;
+
+			[[nodiscard]] inline entryData load() const noexcept { return { data.load(std::memory_order_relaxed) }; }
+			inline void store(const entryData newData) noexcept { data.store(newData.data, std::memory_order_relaxed); }
+		};
+		static constexpr size_t bucketSize { 8 };
+		static constexpr chess::u8 ageMask { 0x3F };
+		struct alignas(64) bucket {
+			std::array<tableEntry, bucketSize> entries;
 		};
+		static_assert(sizeof(tableEntry) == 8 && sizeof(bucket) == 64, "Transposition table buckets must fill exactly one cache line");
+		static_assert(std::atomic<u64>::is_always_lock_free, "Transposition table entries must be lock free");
 
 	private:
-		const chess::game& boardPos;
-		std::unique_ptr<std::array<tableEntry, sz>> tableData;
-		const decltype(tableData->data()) tableDataBegin;
-		size_t overwrites = 0;
+		std::unique_ptr<bucket[]> tableData;
+		size_t bucketCount = 0;
+		std::atomic<size_t> overwrites { 0 };
+		chess::u8 age = 0;
 
 	public:
-		transpositionTable(const chess::game& board) :
-			boardPos { board }, tableData { std::make_unique<std::array<tableEntry, sz>>() }, tableDataBegin { tableData->data() }, overwrites { 0 } {}
+		transpositionTable(const size_t megabytes) { this->resize(megabytes); }
 
 		static constexpr int lookupFailed { std::numeric_limits<int>::min() };
 		static constexpr int unused { 0 };
@@ -71,49 +147,119 @@ namespace chess::ai {
 		static constexpr int lowerBound { 2 };
 		static constexpr int upperBound { 3 };
 
-		size_t getOverwrites() {
-			return overwrites;
+		// Resizes (and clears) the table to the largest power of two bucket count that fits in the given megabytes
+		void resize(const size_t megabytes) {
+			size_t newBucketCount { 1 };
+			while (newBucketCount * 2 * sizeof(bucket) <= std::max<size_t>(megabytes, 1) * 1024 * 1024) {
+				newBucketCount *= 2;
+			}
+			this->tableData   = std::make_unique<bucket[]>(newBucketCount);
+			this->bucketCount = newBucketCount;
+			this->clear();
 		}
 		void clear() {
-			std::fill(tableData->begin(), tableData->end(), { 0, { 0, 0, 0 }, 0, 0, 0 });
+			for (size_t index { 0 }; index < this->bucketCount; index++) {
+				for (auto& entry : this->tableData[index].entries) {
+					entry.store({ 0 });
+				}
+			}
+			this->overwrites = 0;
+			this->age        = 0;
 		}
+		// Called once per search (before any search threads start) so that entries from previous searches are replaced first
+		void newSearch() noexcept { this->age = (this->age + 1) & ageMask; }
 
-		[[nodiscard]] inline u64 index() const noexcept {
-			return boardPos.currentPosition().zobristHash & (sz - 1);
+		size_t getOverwrites() const noexcept {
+			return overwrites.load(std::memory_order_relaxed);
 		}
+		[[nodiscard]] size_t size() const noexcept { return this->bucketCount * bucketSize; }
 
-		[[nodiscard]] inline chess::moveData getStoredMove() const noexcept {
-			return tableDataBegin[index()].move;
+		// Mate scores are stored relative to the node, and read back relative to the root
+		[[nodiscard]] static constexpr int scoreToTT(const int posEval, const int height) noexcept {
+			return posEval > mateThreshold ? posEval + height : (posEval < -mateThreshold ? posEval - height : posEval);
+		}
+		[[nodiscard]] static constexpr int scoreFromTT(const int posEval, const int height) noexcept {
+			return posEval > mateThreshold ? posEval - height : (posEval < -mateThreshold ? posEval + height : posEval);
 		}
 
-		void storeEval(int depth, int posEval, int evalType, chess::moveData move) {
-			if (tableDataBegin[index()].nodeType != unused)
-				overwrites++;
+		[[nodiscard]] inline bucket& bucketOf(const u64 key) const noexcept {
+			return this->tableData[key & (this->bucketCount - 1)];
+		}
+		// Starts loading the bucket of a position that is about to be searched, while its moves are generated
+		inline void prefetch(const u64 key) const noexcept { chess::util::prefetch(&this->bucketOf(key)); }
 
-			if (depth >= tableDataBegin[index()].depth) {
-				tableDataBegin[index()] = { .key      = boardPos.currentPosition().zobristHash,
-					                        .move     = move,
-					                        .posEval  = posEval,
-					                        .depth    = depth,
-					                        .nodeType = evalType };
+		// Copies out the entry for the position, if there is one that verifies
+		[[nodiscard]] inline bool find(const u64 key, entryData& found) const noexcept {
+			const chess::u16 keyCheck { entryData::keyCheckOf(key) };
+			for (const auto& entry : this->bucketOf(key).entries) {
+				found = entry.load();
+				if (found.nodeType() != unused && found.keyCheck() == keyCheck)
+					return true;
 			}
+			return false;
 		}
 
-		int lookupEval(int depth, int alpha, int beta) {
-			tableEntry lookupEntry { tableDataBegin[index()] };
-			if (lookupEntry.key == boardPos.currentPosition().zobristHash) {
-				if (lookupEntry.depth >= depth) {
-					if (lookupEntry.nodeType == exact) {
-						return lookupEntry.posEval;
-					}
+		// The stored best move of a position, or a null move. With only 16 bits of the key kept, an entry can belong to another position,
+		// so the move is rebuilt from the position and only returned if it is legal there.
+		[[nodiscard]] inline chess::moveData getStoredMove(const chess::position& toSearch) const noexcept {
+			constexpr chess::moveData noMove { 0, 0, 0 };
+			entryData found;
+			if (!this->find(toSearch.zobristHash, found) || found.packedMove() == 0)
+				return noMove;
+			const chess::u16 packedMove { found.packedMove() };
+			const chess::moveData storedMove { toSearch.pseudoLegalMove(static_cast<chess::square>(packedMove & 0x3F), static_cast<chess::square>((packedMove >> 6) & 0x3F), static_cast<chess::piece>(packedMove >> 12)) };
+			return storedMove != noMove && toSearch.isLegal(storedMove) ? storedMove : noMove;
+		}
 
-					if (lookupEntry.nodeType == upperBound && lookupEntry.posEval <= alpha) {
-						return lookupEntry.posEval;
-					}
+		void storeEval(const u64 key, const int depth, const int height, const int posEval, const int evalType, const chess::moveData move) {
+			// Reuse the entry for this position if it exists, otherwise replace the shallowest, oldest entry
+			const auto replaceValue = [this](const entryData entry) {
+				return entry.depth() - ((this->age - entry.age()) & ageMask) * 8;
+			};
+			const chess::u16 keyCheck { entryData::keyCheckOf(key) };
+			auto& entries { this->bucketOf(key).entries };
+			tableEntry* replace { &entries[0] };
+			entryData replaceData { entries[0].load() };
+			for (auto& entry : entries) {
+				const entryData storedData { entry.load() };
+				if (storedData.nodeType() == unused || storedData.keyCheck() == keyCheck) {
+					replace     = &entry;
+					replaceData = storedData;
+					break;
+				}
+				if (replaceValue(storedData) < replaceValue(replaceData)) {
+					replace     = &entry;
+					replaceData = storedData;
+				}
+			}
+			const bool samePosition { replaceData.nodeType() != unused && replaceData.keyCheck() == keyCheck };
 
-					if (lookupEntry.nodeType == lowerBound && lookupEntry.posEval >= beta) {
-						return lookupEntry.posEval;
-					}
+			if (replaceData.nodeType() != unused && !samePosition) {
+#ifdef AI_DEBUG
+				overwrites.fetch_add(1, std::memory_order_relaxed);
+#endif
+			} else if (samePosition && replaceData.age() == this->age && depth < replaceData.depth() && evalType != exact) {
+				return;    // Keep the deeper result from this search
+			}
+
+			// Keep the old best move if there isn't a new one
+			const chess::u16 packedMove { move == chess::moveData { 0, 0, 0 } && samePosition ? replaceData.packedMove() : entryData::packMove(move) };
+			replace->store(entryData::pack(key, packedMove, scoreToTT(posEval, height), depth, evalType, this->age));
+		}
+
+		int lookupEval(const u64 key, const int depth, const int height, const int alpha, const int beta) const {
+			if (entryData lookupEntry; this->find(key, lookupEntry) && lookupEntry.depth() >= depth) {
+				const int posEval { scoreFromTT(lookupEntry.posEval(), height) };
+				if (lookupEntry.nodeType() == exact) {
+					return posEval;
+				}
+
+				if (lookupEntry.nodeType() == upperBound && posEval <= alpha) {
+					return posEval;
+				}
+
+				if (lookupEntry.nodeType() == lowerBound && posEval >= beta) {
+					return posEval;
 				}
 			}
 			return lookupFailed;
@@ -139,172 +285,840 @@ namespace chess::ai {
 		} evaluate;
 	};
 
+	// Positional bonus of each piece type (by index) on each square, from white's side of the board: a8 first, h1 last
+	namespace pieceSquare {
+		using table = std::array<std::array<int, 64>, 7>;
+		constexpr std::array<int, 7> phaseWeights { 0, 0, 1, 1, 2, 4, 0 };    // Game phase of each piece type, it is fully midgame at maxPhase
+		constexpr int maxPhase { 24 };
+		// clang-format off
+		constexpr table midgame { {
+			{},
+			{   0,   0,   0,   0,   0,   0,   0,   0,
+			   50,  50,  50,  50,  50,  50,  50,  50,
+			   10,  10,  20,  30,  30,  20,  10,  10,
+			    5,   5,  10,  25,  25,  10,   5,   5,
+			    0,   0,   0,  20,  20,   0,   0,   0,
+			    5,  -5, -10,   0,   0, -10,  -5,   5,
+			    5,  10,  10, -20, -20,  10,  10,   5,
+			    0,   0,   0,   0,   0,   0,   0,   0 },
+			{ -50, -40, -30, -30, -30, -30, -40, -50,
+			  -40, -20,   0,   0,   0,   0, -20, -40,
+			  -30,   0,  10,  15,  15,  10,   0, -30,
+			  -30,   5,  15,  20,  20,  15,   5, -30,
+			  -30,   0,  15,  20,  20,  15,   0, -30,
+			  -30,   5,  10,  15,  15,  10,   5, -30,
+			  -40, -20,   0,   5,   5,   0, -20, -40,
+			  -50, -40, -30, -30, -30, -30, -40, -50 },
+			{ -20, -10, -10, -10, -10, -10, -10, -20,
+			  -10,   0,   0,   0,   0,   0,   0, -10,
+			  -10,   0,   5,  10,  10,   5,   0, -10,
+			  -10,   5,   5,  10,  10,   5,   5, -10,
+			  -10,   0,  10,  10,  10,  10,   0, -10,
+			  -10,  10,  10,  10,  10,  10,  10, -10,
+			  -10,   5,   0,   0,   0,   0,   5, -10,
+			  -20, -10, -10, -10, -10, -10, -10, -20 },
+			{   0,   0,   0,   0,   0,   0,   0,   0,
+			    5,  10,  10,  10,  10,  10,  10,   5,
+			   -5,   0,   0,   0,   0,   0,   0,  -5,
+			   -5,   0,   0,   0,   0,   0,   0,  -5,
+			   -5,   0,   0,   0,   0,   0,   0,  -5,
+			   -5,   0,   0,   0,   0,   0,   0,  -5,
+			   -5,   0,   0,   0,   0,   0,   0,  -5,
+			    0,   0,   0,   5,   5,   0,   0,   0 },
+			{ -20, -10, -10,  -5,  -5, -10, -10, -20,
+			  -10,   0,   0,   0,   0,   0,   0, -10,
+			  -10,   0,   5,   5,   5,   5,   0, -10,
+			   -5,   0,   5,   5,   5,   5,   0,  -5,
+			   -5,   0,   5,   5,   5,   5,   0,  -5,
+			  -10,   0,   5,   5,   5,   5,   0, -10,
+			  -10,   0,   0,   0,   0,   0,   0, -10,
+			  -20, -10, -10,  -5,  -5, -10, -10, -20 },
+			{ -30, -40, -40, -50, -50, -40, -40, -30,
+			  -30, -40, -40, -50, -50, -40, -40, -30,
+			  -30, -40, -40, -50, -50, -40, -40, -30,
+			  -30, -40, -40, -50, -50, -40, -40, -30,
+			  -20, -30, -30, -40, -40, -30, -30, -20,
+			  -10, -20, -20, -20, -20, -20, -20, -10,
+			   20,  20,   0,   0,   0,   0,  20,  20,
+			   20,  30,  10,   0,   0,  10,  30,  20 }
+		} };
+		// Pawns are worth more the further they are pushed, and the king belongs in the centre once the pieces are gone
+		constexpr table endgame { {
+			{},
+			{   0,   0,   0,   0,   0,   0,   0,   0,
+			   80,  80,  80,  80,  80,  80,  80,  80,
+			   50,  50,  50,  50,  50,  50,  50,  50,
+			   30,  30,  30,  30,  30,  30,  30,  30,
+			   15,  15,  15,  15,  15,  15,  15,  15,
+			    5,   5,   5,   5,   5,   5,   5,   5,
+			    0,   0,   0,   0,   0,   0,   0,   0,
+			    0,   0,   0,   0,   0,   0,   0,   0 },
+			midgame[knight],
+			midgame[bishop],
+			midgame[rook],
+			midgame[queen],
+			{ -50, -40, -30, -20, -20, -30, -40, -50,
+			  -30, -20, -10,   0,   0, -10, -20, -30,
+			  -30, -10,  20,  30,  30,  20, -10, -30,
+			  -30, -10,  30,  40,  40,  30, -10, -30,
+			  -30, -10,  30,  40,  40,  30, -10, -30,
+			  -30, -10,  20,  30,  30,  20, -10, -30,
+			  -30, -30,   0,   0,   0,   0, -30, -30,
+			  -50, -30, -30, -30, -30, -30, -30, -50 }
+		} };
+		// clang-format on
+	}    // namespace pieceSquare
+
+	// Terms of the evaluation that depend only on where the pawns are, cached by the pawn hash of the position.
+	// Colours are indexed by color >> 3 (black 0, white 1), ranks by distance from the colour's own back rank.
+	namespace pawnStructure {
+		constexpr chess::evalAccumulator doubled { -10, -20, 0 };                               // For each pawn behind another on its file
+		constexpr chess::evalAccumulator isolated { -10, -15, 0 };                              // No friendly pawns on the files beside it
+		constexpr std::array<int, 8> passedMidgame { 0, 5, 10, 15, 25, 40, 60, 0 };             // No enemy pawns ahead of it on its or the files beside it
+		constexpr std::array<int, 8> passedEndgame { 0, 10, 20, 35, 60, 90, 130, 0 };
+		constexpr std::array<int, 8> passedUnblocked { 0, 0, 5, 10, 20, 35, 55, 0 };           // Endgame bonus when the square in front of a passed pawn is empty
+		constexpr int shelterNear { 12 };                                                       // Midgame bonus for each file beside the king with a pawn on the rank in front of it
+		constexpr int shelterFar { 6 };                                                         // or on the rank after that
+		constexpr int shelterOpen { -15 };                                                      // or with neither
+		constexpr int kingShelterRanks { 2 };                                                   // The king is only sheltered on its first two ranks
+
+		[[nodiscard]] constexpr chess::u64 fileOf(const int file) noexcept { return file >= 0 && file < 8 ? 0x0101010101010101ULL << file : 0; }
+		[[nodiscard]] constexpr chess::u64 rankOf(const int rank) noexcept { return rank >= 0 && rank < 8 ? 0xFFULL << (rank * 8) : 0; }
+		[[nodiscard]] constexpr int relativeRank(const int colorIndex, const int square) noexcept { return colorIndex ? square / 8 : 7 - square / 8; }
+
+		// Squares ahead of a pawn of each colour on its own and the neighbouring files, that must be free of enemy pawns for it to be passed
+		constexpr std::array<std::array<chess::u64, 64>, 2> passedMasks { []() {
+			std::array<std::array<chess::u64, 64>, 2> result {};
+			for (int square { 0 }; square < 64; square++) {
+				const chess::u64 files { fileOf(square % 8 - 1) | fileOf(square % 8) | fileOf(square % 8 + 1) };
+				for (int rank { 0 }; rank < 8; rank++) {
+					result[0][square] |= rank < square / 8 ? files & rankOf(rank) : 0;
+					result[1][square] |= rank > square / 8 ? files & rankOf(rank) : 0;
+				}
+			}
+			return result;
+		}() };
+
+		struct entry {
+			chess::u64 key;
+			std::array<chess::u64, 2> passed;                 // Passed pawns of each colour
+			chess::evalAccumulator score;                     // Doubled, isolated and passed pawns, white's point of view
+			std::array<std::array<std::int16_t, 8>, 2> shelter;    // Shelter of each colour's king by the file it is on
+		};
+
+		[[nodiscard]] constexpr entry build(const chess::u64 key, const chess::u64 whitePawns, const chess::u64 blackPawns) noexcept {
+			using namespace chess::util;
+			entry result { .key = key, .passed = {}, .score = {}, .shelter = {} };
+			const std::array<chess::u64, 2> pawns { blackPawns, whitePawns };
+			for (int colorIndex { 0 }; colorIndex < 2; colorIndex++) {
+				const int sign { colorIndex ? 1 : -1 };
+				chess::evalAccumulator side {};
+				for (int file { 0 }; file < 8; file++) {
+					const int onFile { std::popcount(pawns[colorIndex] & fileOf(file)) };
+					side.midgame += std::max(onFile - 1, 0) * doubled.midgame;
+					side.endgame += std::max(onFile - 1, 0) * doubled.endgame;
+					if (!(pawns[colorIndex] & (fileOf(file - 1) | fileOf(file + 1)))) {
+						side.midgame += onFile * isolated.midgame;
+						side.endgame += onFile * isolated.endgame;
+					}
+
+					// Shelter of a king on this file from the pawns on the second and third ranks in front of it
+					const int nearRank { colorIndex ? 1 : 6 }, farRank { colorIndex ? 2 : 5 };
+					int shelter { 0 };
+					for (int shelterFile { std::max(file - 1, 0) }; shelterFile <= std::min(file + 1, 7); shelterFile++) {
+						shelter += pawns[colorIndex] & fileOf(shelterFile) & rankOf(nearRank) ? shelterNear : (pawns[colorIndex] & fileOf(shelterFile) & rankOf(farRank) ? shelterFar : shelterOpen);
+					}
+					result.shelter[colorIndex][file] = static_cast<std::int16_t>(shelter);
+				}
+				for (chess::u64 remaining { pawns[colorIndex] }; remaining; zeroLSB(remaining)) {
+					const int square { std::countr_zero(remaining) };
+					if (!(passedMasks[colorIndex][square] & pawns[colorIndex ^ 1])) {
+						result.passed[colorIndex] |= 1ULL << square;
+						side.midgame += passedMidgame[relativeRank(colorIndex, square)];
+						side.endgame += passedEndgame[relativeRank(colorIndex, square)];
+					}
+				}
+				result.score.midgame += sign * side.midgame;
+				result.score.endgame += sign * side.endgame;
+			}
+			return result;
+		}
+
+		// Caches pawn structure by pawn hash, pawns move rarely enough that nearly every probe in a search hits.
+		// Each search thread owns one, so entries are written without synchronisation.
+		class table {
+		public:
+			static constexpr size_t defaultEntries { 1 << 16 };
+
+		private:
+			std::vector<entry> entries;
+
+		public:
+			table(const size_t entryCount = defaultEntries) :
+				entries(std::bit_floor(std::max<size_t>(entryCount, 1)), build(0, 0, 0)) {}    // Every entry starts as the position without pawns, which has a pawn hash of 0
+			[[nodiscard]] const entry& probe(const chess::position& toProbe) noexcept {
+				entry& found { this->entries[toProbe.pawnHash & (this->entries.size() - 1)] };
+				if (found.key != toProbe.pawnHash)
+					found = build(toProbe.pawnHash, toProbe.bitboards[chess::piece::whitePawn], toProbe.bitboards[chess::piece::blackPawn]);
+				return found;
+			}
+		};
+	}    // namespace pawnStructure
+
 	class bot {
 	private:
 		botWeights internalWeights;
+		chess::pieceSquareScores pieceSquareScores;                          // Material from the weights plus the positional bonus
+		std::shared_ptr<const chess::ai::nnue::network> evaluationNetwork;    // Evaluates instead of the piece-square scores when set
+
+		[[nodiscard]] static chess::pieceSquareScores buildPieceSquareScores(const botWeights& weights) noexcept {
+			using namespace chess::util;
+			chess::pieceSquareScores result {};
+			for (chess::piece pieceType { pawn }; pieceType <= king; pieceType = static_cast<chess::piece>(pieceType + 1)) {
+				for (size_t tableIndex { 0 }; tableIndex < 64; tableIndex++) {
+					// Black uses the table mirrored vertically
+					const size_t whiteSquare { (7 - tableIndex / 8) * 8 + (7 - tableIndex % 8) };
+					const size_t blackSquare { (tableIndex / 8) * 8 + (7 - tableIndex % 8) };
+					const chess::piece whitePiece { constructPiece(pieceType, white) };
+					const chess::piece blackPiece { constructPiece(pieceType, black) };
+					result[whitePiece][whiteSquare] = { weights.evaluate.pieceValues[whitePiece] + pieceSquare::midgame[pieceType][tableIndex],
+						                                weights.evaluate.pieceValues[whitePiece] + pieceSquare::endgame[pieceType][tableIndex],
+						                                pieceSquare::phaseWeights[pieceType] };
+					result[blackPiece][blackSquare] = { -(weights.evaluate.pieceValues[blackPiece] + pieceSquare::midgame[pieceType][tableIndex]),
+						                                -(weights.evaluate.pieceValues[blackPiece] + pieceSquare::endgame[pieceType][tableIndex]),
+						                                pieceSquare::phaseWeights[pieceType] };
+				}
+			}
+			return result;
+		}
 
 	public:
 		bot(const botWeights& setWeights) :
-			internalWeights { setWeights } {}
-		// Order moves to induce more beta cutoffs
-		template <size_t TTsz>
-		void orderMoves(moveList& moveList, const transpositionTable<TTsz>& TT) const noexcept {
-			std::array<int, chess::constants::maxMoves> moveEvaluationHeuristicList {};
-			const auto hashMove { TT.getStoredMove() };
-			auto evaluateInsertLocation { moveEvaluationHeuristicList.begin() };
-			for (const auto moveToEvaluate : moveList) {
-				*evaluateInsertLocation = ((hashMove == moveToEvaluate) ? this->internalWeights.moveOrdering.hashMove : this->internalWeights.moveOrdering.notHashMove);
-				if (moveToEvaluate.moveFlags() >= 0x0100 && moveToEvaluate.moveFlags() <= 0x0F00) {
-                    // Promotion
-                    *evaluateInsertLocation += this->internalWeights.moveOrdering.pieceValues[moveToEvaluate.promotionPiece()] * this->internalWeights.moveOrdering.promotionMultiplier;
-                } else if (moveToEvaluate.moveFlags() >= 0x1100 && moveToEvaluate.moveFlags() <= 0x1F00) {
-                    // Promotion & Capture
-                    *evaluateInsertLocation += this->internalWeights.moveOrdering.pieceValues[moveToEvaluate.promotionPiece()] * this->internalWeights.moveOrdering.promotionMultiplier;
-                    *evaluateInsertLocation += (this->internalWeights.moveOrdering.pieceValues[moveToEvaluate.capturedPiece()] - this->internalWeights.moveOrdering.pieceValues[moveToEvaluate.movePiece()]) * this->internalWeights.moveOrdering.captureMultiplier;
-                } else if (moveToEvaluate.moveFlags() == 0x1000) {
-                    // Capture logic
-                    *evaluateInsertLocation += (this->internalWeights.moveOrdering.pieceValues[moveToEvaluate.capturedPiece()] - this->internalWeights.moveOrdering.pieceValues[moveToEvaluate.movePiece()]) * this->internalWeights.moveOrdering.captureMultiplier;
-                } else if (moveToEvaluate.moveFlags() == 0x2000) {
-                    // Kingside castling
-                    *evaluateInsertLocation += this->internalWeights.moveOrdering.kingsideCastling;
-                } else if (moveToEvaluate.moveFlags() == 0x3000) {
-                    // Queenside castling
-                    *evaluateInsertLocation += this->internalWeights.moveOrdering.queensideCastling;
-                } else if (moveToEvaluate.moveFlags() == 0x4000) {
-                    // En passant
-                    *evaluateInsertLocation += this->internalWeights.moveOrdering.enPassant;
-                } else if (moveToEvaluate.moveFlags() == 0x5000) {
-                    // En passant capture
-                    *evaluateInsertLocation += this->internalWeights.moveOrdering.enPassant;
-                    *evaluateInsertLocation += (this->internalWeights.moveOrdering.pieceValues[moveToEvaluate.capturedPiece()] - this->internalWeights.moveOrdering.pieceValues[moveToEvaluate.movePiece()]) * this->internalWeights.moveOrdering.captureMultiplier;
-                } else if (moveToEvaluate.moveFlags() == 0x6000) {
-                    // Pawn double push
-                    *evaluateInsertLocation += this->internalWeights.moveOrdering.pawnDoublePush;
-                } else if (moveToEvaluate.moveFlags() == 0x7000) {
-                    // Pawn double push capture
-                    *evaluateInsertLocation += this->internalWeights.moveOrdering.pawnDoublePush;
-                    *evaluateInsertLocation += (this->internalWeights.moveOrdering.pieceValues[moveToEvaluate.capturedPiece()] - this->internalWeights.moveOrdering.pieceValues[moveToEvaluate.movePiece()]) * this->internalWeights.moveOrdering.captureMultiplier;
-                } else {
-                    // Default move
-                    *evaluateInsertLocation += this->internalWeights.moveOrdering.defaultMove;
+			internalWeights { setWeights }, pieceSquareScores { buildPieceSquareScores(setWeights) }, evaluationNetwork { nullptr } {}
+		// Pass nullptr to go back to the piece-square evaluation
+		void setNetwork(std::shared_ptr<const chess::ai::nnue::network> newNetwork) noexcept { this->evaluationNetwork = std::move(newNetwork); }
+		[[nodiscard]] const chess::ai::nnue::network* network() const noexcept { return this->evaluationNetwork.get(); }
+		// The table positions have to be scored with (position::setEvaluation) for evaluate to read them
+		[[nodiscard]] const chess::pieceSquareScores& scores() const noexcept { return this->pieceSquareScores; }
+		// Material won by the side to move from a move and the trades that follow it
+		[[nodiscard]] int staticExchange(const chess::position& toEvaluate, const chess::moveData moveToEvaluate) const noexcept {
+			return toEvaluate.staticExchange(moveToEvaluate, this->internalWeights.moveOrdering.pieceValues);
+		}
+		// Heuristic value of a move, higher is searched earlier
+		[[nodiscard]] int moveScore(const chess::position& toEvaluate, const chess::moveData moveToEvaluate, const chess::moveData hashMove) const noexcept {
+			int result = ((hashMove == moveToEvaluate) ? this->internalWeights.moveOrdering.hashMove : this->internalWeights.moveOrdering.notHashMove);
+			if (moveToEvaluate.moveFlags() >= 0x0100 && moveToEvaluate.moveFlags() <= 0x0F00) {
+				// Promotion
+				result += this->internalWeights.moveOrdering.pieceValues[moveToEvaluate.promotionPiece()] * this->internalWeights.moveOrdering.promotionMultiplier;
+			} else if (moveToEvaluate.moveFlags() >= 0x1100 && moveToEvaluate.moveFlags() <= 0x1F00) {
+				// Promotion & Capture
+				result += this->internalWeights.moveOrdering.pieceValues[moveToEvaluate.promotionPiece()] * this->internalWeights.moveOrdering.promotionMultiplier;
+				result += this->staticExchange(toEvaluate, moveToEvaluate) * this->internalWeights.moveOrdering.captureMultiplier;
+			} else if (moveToEvaluate.moveFlags() == 0x1000) {
+				// Capture logic
+				result += this->staticExchange(toEvaluate, moveToEvaluate) * this->internalWeights.moveOrdering.captureMultiplier;
+			} else if (moveToEvaluate.moveFlags() == 0x2000 || moveToEvaluate.moveFlags() == 0x4000) {
+				// Kingside castling
+				result += this->internalWeights.moveOrdering.kingsideCastling;
+			} else if (moveToEvaluate.moveFlags() == 0x3000 || moveToEvaluate.moveFlags() == 0x5000) {
+				// Queenside castling
+				result += this->internalWeights.moveOrdering.queensideCastling;
+			} else if (moveToEvaluate.moveFlags() == 0x6000 || moveToEvaluate.moveFlags() == 0x7000) {
+				// En passant
+				result += this->internalWeights.moveOrdering.enPassant;
+				result += this->staticExchange(toEvaluate, moveToEvaluate) * this->internalWeights.moveOrdering.captureMultiplier;
+			} else if (moveToEvaluate.moveFlags() == 0x8000 || moveToEvaluate.moveFlags() == 0x9000) {
+				// Pawn double push
+				result += this->internalWeights.moveOrdering.pawnDoublePush;
+			} else {
+				// Default move
+				result += this->internalWeights.moveOrdering.defaultMove;
+			}
+			return result;
+		}
+		// Captures that score below this lose material in the exchange, and are searched after the quiet moves
+		[[nodiscard]] int goodCaptureScore() const noexcept {
+			return this->internalWeights.moveOrdering.notHashMove;
+		}
+		// Scores moves generated through moveBuffer for ordering, so they can be picked best first
+		[[nodiscard]] chess::scoredMoveSlice scoreMoves(const chess::position& toEvaluate, const chess::moveSlice& toScore, const chess::moveData hashMove, chess::moveStack::frame& moveBuffer) const noexcept {
+			return moveBuffer.score(toScore, [this, &toEvaluate, hashMove](const chess::moveData moveToEvaluate) { return this->moveScore(toEvaluate, moveToEvaluate, hashMove); });
+		}
+		// Order moves generated through moveBuffer in place to induce more beta cutoffs
+		void orderMoves(const chess::position& toEvaluate, const chess::moveSlice& toOrder, const chess::moveData hashMove, chess::moveStack::frame& moveBuffer) const noexcept {
+			chess::scoredMoveSlice scoredMoves { this->scoreMoves(toEvaluate, toOrder, hashMove, moveBuffer) };
+			for (chess::moveData picked; scoredMoves.pickBest(picked);) {}
+		}
+
+		// The position keeps its material and piece-square scores up to date, and the pawn structure comes from the cache, so the scores only need to
+		// be blended by the phase (requires the position to be scored with scores())
+		[[nodiscard]] int evaluate(const chess::position& toEvaluate, pawnStructure::table& pawnCache) const noexcept {
+			using namespace chess::util;
+			const pawnStructure::entry& pawns { pawnCache.probe(toEvaluate) };
+			chess::evalAccumulator accumulated { toEvaluate.evaluation };
+			accumulated += pawns.score;
+			for (int colorIndex { 0 }; colorIndex < 2; colorIndex++) {
+				const chess::piece color { colorIndex ? white : black };
+				const int sign { colorIndex ? 1 : -1 };
+				const int kingSquare { ctz64(toEvaluate.bitboards[constructPiece(king, color)]) };
+				accumulated.midgame += sign * (pawnStructure::relativeRank(colorIndex, kingSquare) < pawnStructure::kingShelterRanks ? pawns.shelter[colorIndex][kingSquare % 8] : 3 * pawnStructure::shelterOpen);
+				for (chess::u64 passed { pawns.passed[colorIndex] }; passed; zeroLSB(passed)) {
+					const int square { ctz64(passed) };
+					if (toEvaluate.empty() & bitboardFromIndex(colorIndex ? square + 8 : square - 8))
+						accumulated.endgame += sign * pawnStructure::passedUnblocked[pawnStructure::relativeRank(colorIndex, square)];
 				}
-				++evaluateInsertLocation;
 			}
+			const int phase { std::min(accumulated.phase, pieceSquare::maxPhase) };
+			const int result { (accumulated.midgame * phase + accumulated.endgame * (pieceSquare::maxPhase - phase)) / pieceSquare::maxPhase };
+			return toEvaluate.turn() ? result - toEvaluate.halfMoveClock * 4 : -result + toEvaluate.halfMoveClock * 4;
+		}
+		// Evaluation by the network, from accumulators that have followed the moves made to reach the position
+		[[nodiscard]] int evaluate(const chess::position& toEvaluate, const chess::ai::nnue::accumulatorStack& accumulators) const noexcept {
+			const int result { toEvaluate.turn() ? accumulators.evaluate(toEvaluate) : -accumulators.evaluate(toEvaluate) };
+			return toEvaluate.turn() ? result - toEvaluate.halfMoveClock * 4 : -result + toEvaluate.halfMoveClock * 4;
+		}
+	};
+
+	// Quiet move ordering learned during a search. Each search thread owns one, so it is never shared, and it is allocated once before the search starts.
+	class searchStack {
+	public:
+		static constexpr int maxHistory { 16384 };
+		static constexpr int killerScore { 4 * maxHistory };         // The first killer, the second is one less
+		static constexpr int counterMoveScore { 2 * maxHistory };    // Below the killers, above any history score
+
+		// Extra ordering score of a quiet move, played at height after previousMove
+		[[nodiscard]] int quietScore(const chess::moveData quietMove, const chess::moveData previousMove, const int height) const noexcept {
+			if (quietMove == this->killers[height][0])
+				return killerScore;
+			if (quietMove == this->killers[height][1])
+				return killerScore - 1;
+			if (previousMove != chess::moveData { 0, 0, 0 } && quietMove == this->counterMoves[previousMove.movePiece()][previousMove.destinationIndex])
+				return counterMoveScore;
+			return this->history[quietMove.movePiece() >> 3][quietMove.originIndex][quietMove.destinationIndex];
+		}
+
+		// A quiet move caused a beta cutoff: it becomes a killer and the counter move to previousMove, and the quiets searched before it lose history
+		void quietCutoff(const chess::moveData cutoffMove, const chess::moveData previousMove, const int height, const int depth, const chess::moveData* failedQuiets, const size_t failedQuietCount) noexcept {
+			if (cutoffMove != this->killers[height][0]) {
+				this->killers[height][1] = this->killers[height][0];
+				this->killers[height][0] = cutoffMove;
+			}
+			if (previousMove != chess::moveData { 0, 0, 0 })
+				this->counterMoves[previousMove.movePiece()][previousMove.destinationIndex] = cutoffMove;
+			const int bonus { std::min(16 * depth * depth, maxHistory / 8) };
+			this->updateHistory(cutoffMove, bonus);
+			for (size_t index { 0 }; index < failedQuietCount; index++) {
+				this->updateHistory(failedQuiets[index], -bonus);
+			}
+		}
+
+	private:
+		std::array<std::array<chess::moveData, 2>, maxSearchDepth + 1> killers {};    // [height], the search never goes deeper than its depth
+		std::array<std::array<std::array<int, 64>, 64>, 2> history {};               // [color][origin][destination]
+		std::array<std::array<chess::moveData, 64>, 16> counterMoves {};             // [piece][destination] of the previous move
+
+		// Gravity: the further an entry is from zero the less it moves, so it stays within maxHistory and recent results outweigh old ones
+		void updateHistory(const chess::moveData quietMove, const int bonus) noexcept {
+			int& entry { this->history[quietMove.movePiece() >> 3][quietMove.originIndex][quietMove.destinationIndex] };
+			entry += bonus - entry * std::abs(bonus) / maxHistory;
+		}
+	};
 
-			// Sort based on the evaluation of moves
-			for (int i = 0; i < moveList.size(); i++) {
-				for (int j = i + 1; j < moveList.size(); j++) {
-					if (moveEvaluationHeuristicList[i] < moveEvaluationHeuristicList[j]) {
-						SWAP(moveEvaluationHeuristicList[i], moveEvaluationHeuristicList[j]);
-						SWAP(moveList[i], moveList[j]);
+	// Hands out the moves of a position one at a time: the hash move before anything is generated, then captures, then quiets.
+	// A stage is only generated once the previous one runs out, so a cutoff on an early move skips the rest of the generation.
+	// Captures that lose material in the exchange wait until after the quiet moves.
+	class movePicker {
+	public:
+		// Quiets are ordered by the killers, counter move and history of heuristics, for the node at height reached by previousMove.
+		// Moves are generated into the node's frame of the thread's move stack, and pseudo-legal ones are checked as they are handed out.
+		// hashMove has to be legal in toPick (or null), as it is handed out before anything is generated.
+		movePicker(const chess::position& toPick, const chess::ai::bot& botToUse, const chess::moveData hashMove, const chess::ai::searchStack& heuristics, const chess::moveData previousMove, const int height, chess::moveStack::frame& moveBuffer) noexcept :
+			toPick { toPick }, botToUse { botToUse }, hashMove { hashMove }, heuristics { &heuristics }, moveBuffer { &moveBuffer }, previousMove { previousMove }, height { height }, currentStage { stage::hashMove },
+			captureMoves { nullptr, nullptr, 0 }, quietMoves { nullptr, nullptr, 0 }, orderedMoves { nullptr }, orderedIndex { 0 } {}
+		// Hands out an already ordered list (the root, where every move is searched anyway)
+		movePicker(const chess::position& toPick, const chess::ai::bot& botToUse, const chess::moveSlice& orderedMoves) noexcept :
+			toPick { toPick }, botToUse { botToUse }, hashMove { 0, 0, 0 }, heuristics { nullptr }, moveBuffer { nullptr }, previousMove { 0, 0, 0 }, height { 0 }, currentStage { stage::ordered },
+			captureMoves { nullptr, nullptr, 0 }, quietMoves { nullptr, nullptr, 0 }, orderedMoves { orderedMoves }, orderedIndex { 0 } {}
+
+		[[nodiscard]] bool next(chess::moveData& result) noexcept {
+			switch (this->currentStage) {
+				case stage::hashMove:
+					this->currentStage = stage::generateCaptures;
+					if (this->hashMove != chess::moveData { 0, 0, 0 }) {
+						result = this->hashMove;
+						return true;
 					}
-				}
+					[[fallthrough]];
+				case stage::generateCaptures:
+					this->captureMoves = this->botToUse.scoreMoves(this->toPick, chess::ai::searchMoves(*this->moveBuffer, this->toPick, chess::moveGenType::captures), chess::moveData { 0, 0, 0 }, *this->moveBuffer);
+					this->currentStage = stage::goodCaptures;
+					[[fallthrough]];
+				case stage::goodCaptures:
+					while (this->captureMoves.pickBest(result, this->botToUse.goodCaptureScore())) {
+						if (result != this->hashMove && chess::ai::playable(this->toPick, result))
+							return true;
+					}
+					this->currentStage = stage::generateQuiets;
+					[[fallthrough]];
+				case stage::generateQuiets:
+					this->quietMoves = this->moveBuffer->score(chess::ai::searchMoves(*this->moveBuffer, this->toPick, chess::moveGenType::quiets), [this](const chess::moveData quietMove) {
+						return this->botToUse.moveScore(this->toPick, quietMove, chess::moveData { 0, 0, 0 }) + this->heuristics->quietScore(quietMove, this->previousMove, this->height);
+					});
+					this->currentStage = stage::quiets;
+					[[fallthrough]];
+				case stage::quiets:
+					while (this->quietMoves.pickBest(result)) {
+						if (result != this->hashMove && chess::ai::playable(this->toPick, result))
+							return true;
+					}
+					this->currentStage = stage::badCaptures;
+					[[fallthrough]];
+				case stage::badCaptures:
+					while (this->captureMoves.pickBest(result)) {
+						if (result != this->hashMove && chess::ai::playable(this->toPick, result))
+							return true;
+					}
+					this->currentStage = stage::done;
+					return false;
+				case stage::ordered:
+					if (this->orderedIndex < this->orderedMoves.size()) {
+						result = this->orderedMoves[this->orderedIndex++];
+						return true;
+					}
+					this->currentStage = stage::done;
+					[[fallthrough]];
+				default:
+					return false;
 			}
 		}
 
-		[[nodiscard]] int evaluate(const chess::position& toEvaluate) const noexcept {
-			using namespace chess::util;
-			using namespace chess::constants;
-			static auto pieceValue = [&toEvaluate, this](chess::u8 piece) -> int {
-				static constexpr int pieceValues[] = { 0, 100, 300, 310, 500, 900, 0, 0, 0, 100, 300, 310, 500, 900, 0 };
-				return popcnt64(toEvaluate.bitboards[piece]) * pieceValues[piece];
-			};
+		// Whether the last move handed out is a capture that loses material
+		[[nodiscard]] bool badCapture() const noexcept { return this->currentStage == stage::badCaptures; }
 
-			static auto positionalValue = [&toEvaluate](chess::u8 piece) -> int {
-				static constexpr chess::u64 positionValueCenter      = 0x0000001818000000;
-				static constexpr chess::u64 positionValueLargeCenter = 0x00003C3C3C3C0000;
-				return popcnt64(toEvaluate.bitboards[piece] & positionValueCenter) * 50 + popcnt64(toEvaluate.bitboards[piece] & positionValueLargeCenter) * 25;
-			};
+	private:
+		enum class stage : chess::u8
+		{
+			hashMove,
+			generateCaptures,
+			goodCaptures,
+			generateQuiets,
+			quiets,
+			badCaptures,
+			ordered,
+			done
+		};
 
-			int result = 0;
-			result += pieceValue(whitePawn);
-			result += pieceValue(whiteKnight);
-			result += pieceValue(whiteBishop);
-			result += pieceValue(whiteRook);
-			result += pieceValue(whiteQueen);
-			result += positionalValue(white);
-			result -= pieceValue(blackPawn);
-			result -= pieceValue(blackKnight);
-			result -= pieceValue(blackBishop);
-			result -= pieceValue(blackRook);
-			result -= pieceValue(blackQueen);
-			result -= positionalValue(black);
-			return toEvaluate.turn() ? result - toEvaluate.halfMoveClock * 4 : -result + toEvaluate.halfMoveClock * 4;
+		const chess::position& toPick;
+		const chess::ai::bot& botToUse;
+		chess::moveData hashMove;
+		const chess::ai::searchStack* heuristics;
+		chess::moveStack::frame* moveBuffer;
+		chess::moveData previousMove;
+		int height;
+		stage currentStage;
+		chess::scoredMoveSlice captureMoves;    // Scored in the node's frame
+		chess::scoredMoveSlice quietMoves;
+		chess::moveSlice orderedMoves;    // The list handed to the root
+		chess::u64 orderedIndex;
+	};
+
+	// Limits of a search, in the terms of the UCI go command. Times are in milliseconds, and negative when not given.
+	struct searchLimits {
+		int depth { searchPly };
+		long long whiteTime { -1 };
+		long long blackTime { -1 };
+		long long whiteIncrement { 0 };
+		long long blackIncrement { 0 };
+		int movesToGo { 0 };
+		long long moveTime { -1 };
+	};
+
+	// Set by the thread that started a search, while it runs
+	struct searchSignals {
+		std::atomic<bool> stop { false };         // Abort the search
+		std::atomic<bool> pondering { false };    // Searching on the opponent's time, no time limits apply until a ponderhit clears this
+	};
+
+	// Splits the clock of the side to move into a soft limit, after which no new iteration is started,
+	// and a hard limit, after which the current iteration is aborted.
+	// Only used by the main search thread. While pondering the clock doesn't run, and it starts over on a ponderhit.
+	class timeManager {
+	public:
+		timeManager(const chess::ai::searchLimits& limits, const chess::piece sideToMove, const std::atomic<bool>& pondering) noexcept :
+			start { std::chrono::steady_clock::now() }, softLimit { 0 }, hardLimit { 0 }, timed { true }, pondering { pondering }, ponderedAtStart { pondering.load() } {
+			if (limits.moveTime >= 0) {
+				this->softLimit = this->hardLimit = std::max(limits.moveTime - moveOverhead, 1LL);
+				return;
+			}
+			const long long remaining { sideToMove == chess::piece::white ? limits.whiteTime : limits.blackTime };
+			if (remaining < 0) {
+				this->timed = false;
+				return;
+			}
+			const long long increment { sideToMove == chess::piece::white ? limits.whiteIncrement : limits.blackIncrement };
+			const long long available { std::max(remaining - moveOverhead, 1LL) };
+			const long long maximum { available * 4 / 5 };
+			this->softLimit = std::min(available / (limits.movesToGo > 0 ? limits.movesToGo : defaultMovesToGo) + increment * 3 / 4, maximum);
+			this->hardLimit = std::min(this->softLimit * 4, maximum);
+		}
+
+		[[nodiscard]] long long elapsed() const noexcept {
+			return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - this->start).count();
+		}
+		[[nodiscard]] bool softLimitReached() noexcept { return this->limitReached(this->softLimit); }
+		[[nodiscard]] bool hardLimitReached() noexcept { return this->limitReached(this->hardLimit); }
+
+	private:
+		std::chrono::steady_clock::time_point start;
+		long long softLimit;
+		long long hardLimit;
+		bool timed;
+		const std::atomic<bool>& pondering;
+		bool ponderedAtStart;
+
+		[[nodiscard]] bool limitReached(const long long limit) noexcept {
+			if (!this->timed || this->pondering.load(std::memory_order_relaxed))
+				return false;
+			if (this->ponderedAtStart) {
+				// First check since the ponderhit, the time spent pondering was the opponent's
+				this->ponderedAtStart = false;
+				this->start           = std::chrono::steady_clock::now();
+			}
+			return this->elapsed() >= limit;
 		}
 	};
 
-	chess::moveData bestMove(chess::game& gameToTest, const chess::ai::bot& botToUse) {
-#ifdef AI_DEBUG
-		static size_t totalNodes = 0;
-#endif
-		[[maybe_unused]] size_t nodes = 0;
+	struct searchResult {
+		chess::moveData move;
+		int eval;
+		size_t nodes;
+		int depth;    // Last iteration the main thread completed
+		chess::moveData ponderMove;    // Expected reply to move, from the table (or null)
+	};
+
+	// Called by the main search thread after every iteration it completes, with the result so far (without a ponder move) and the milliseconds since the search started
+	using iterationCallback = std::function<void(const chess::ai::searchResult&, long long)>;
+
+	// Iterative deepening over lazy SMP: every thread deepens its own copy of the game, and they share results through the transposition table.
+	// Only the result of the main thread (threadIndex 0) is reported, from the last iteration it completed.
+	// signals.stop may be set by another thread to abort the search (the first iteration always completes), and is set once the search returns.
+	searchResult search(const chess::game& rootGame, const chess::ai::bot& botToUse, chess::ai::transpositionTable& TT, const size_t threadCount, const chess::ai::searchLimits& limits, chess::ai::searchSignals& signals,
+	                    const chess::ai::iterationCallback& onIteration = {}) {
 		struct minimaxOutput {
 			int eval;
 			chess::moveData reccomendedMove;
 		};
+		struct threadOutput {
+			minimaxOutput best;
+			int depth;
+		};
 
-		//transpositionTable<(1 << 24)> TT { gameToTest };
+		TT.newSearch();
+		std::atomic<bool>& stop { signals.stop };
+		chess::ai::timeManager clock { limits, rootGame.currentPosition().turn(), signals.pondering };
+		const auto searchStart { std::chrono::steady_clock::now() };    // The clock starts over on a ponderhit, this doesn't
 
-		auto alphaBeta = [&gameToTest, &nodes, /*&TT,*/ &botToUse](const auto alphaBeta, int alpha, const int beta, const int ply, const bool capture) -> minimaxOutput {
-			if ((ply < 1 && !capture) || ply < maxQSearchPly) {
-#ifdef AI_DEBUG
+		// Every thread publishes its node count after each iteration, so the main thread can report the total while the others are still searching
+		std::vector<std::atomic<size_t>> threadNodes(std::max<size_t>(threadCount, 1));
+		auto searchThread = [&rootGame, &botToUse, &TT, &stop, &limits, &clock, &searchStart, &threadNodes, &onIteration](const size_t threadIndex) -> threadOutput {
+			chess::game gameToTest { rootGame };
+			gameToTest.current.setEvaluation(botToUse.scores());    // The search never undoes the moves before the root, which keep their old scores
+			size_t nodes = 0;
+			size_t nextTimeCheck { timeCheckInterval };
+			const size_t rootHistorySize { rootGame.gameHistory.size() };
+			const auto heuristics { std::make_unique<chess::ai::searchStack>() };
+			const auto moveBuffers { std::make_unique<chess::moveStack>(maxSearchDepth - maxQSearchPly + 1) };
+			// Kept only when the bot evaluates with a network, every move of the search goes through these
+			const auto accumulators { botToUse.network() ? std::make_unique<chess::ai::nnue::accumulatorStack>(*botToUse.network(), gameToTest.currentPosition(), maxSearchDepth - maxQSearchPly + 1) : nullptr };
+			auto makeMove = [&gameToTest, &accumulators, &TT](const chess::moveData desiredMove) {
+				if (accumulators)
+					accumulators->move(gameToTest, desiredMove);
+				else
+					gameToTest.move(desiredMove);
+				TT.prefetch(gameToTest.currentPosition().zobristHash);
+			};
+			auto makeNullMove = [&gameToTest, &accumulators, &TT]() {
+				if (accumulators)
+					accumulators->nullMove(gameToTest);
+				else
+					gameToTest.nullMove();
+				TT.prefetch(gameToTest.currentPosition().zobristHash);
+			};
+			auto undoMove = [&gameToTest, &accumulators]() {
+				if (accumulators)
+					accumulators->undo(gameToTest);
+				else
+					gameToTest.undo();
+			};
+			const auto pawnCache { std::make_unique<chess::ai::pawnStructure::table>() };
+			auto evaluate = [&gameToTest, &botToUse, &accumulators, &pawnCache]() -> int {
+				return accumulators ? botToUse.evaluate(gameToTest.currentPosition(), *accumulators) : botToUse.evaluate(gameToTest.currentPosition(), *pawnCache);
+			};
+			threadOutput output { { 0, { 0, 0, 0 } }, 0 };
+
+			// Searches captures (and quiet checks on its first ply) until the position is quiet enough to evaluate
+			auto quiescence = [&gameToTest, &nodes, &botToUse, &moveBuffers, &makeMove, &undoMove, &evaluate](const auto quiescence, int alpha, const int beta, const int qPly, const int height) -> int {
 				nodes++;
-#endif
-				return { botToUse.evaluate(gameToTest.currentPosition()), { 0, 0, 0 } };
-			}
-			auto legalMoves = gameToTest.moves();
-			if (legalMoves.size() == 0) {
-				return {
-					(gameToTest.threeFoldRep() || gameToTest.currentPosition().halfMoveClock >= 50)
-						? -500
-						: (gameToTest.currentPosition().turn()
-					           ? (gameToTest.currentPosition().inCheck<white>() ? -20000 - ply * 128 : -500)
-					           : (gameToTest.currentPosition().inCheck<black>() ? -20000 - ply * 128 : -500)),
-					{ 0, 0, 0 }
+				const chess::position& current { gameToTest.currentPosition() };
+				if (qPly <= maxQSearchPly) {
+					return evaluate();
+				}
+				// Returns true on a beta cutoff
+				const auto searchMove = [&](const chess::moveData qMove) -> bool {
+					makeMove(qMove);
+					const int posEval { -quiescence(quiescence, -beta, -alpha, qPly - 1, height + 1) };
+					undoMove();
+					alpha = std::max(alpha, posEval);
+					return posEval >= beta;
 				};
-			}
 
-			/*const int ttVal = TT.lookupEval(ply, alpha, beta);
-			if (ttVal != decltype(TT)::lookupFailed) {
-				return { ttVal, TT.getStoredMove() };
-			}
+				const bool inCheck { sideToMoveInCheck(current) };
+				chess::moveStack::frame moveBuffer { *moveBuffers };
+				if (inCheck) {
+					// Standing pat isn't an option when in check, so every evasion is searched
+					chess::scoredMoveSlice qMoves { botToUse.scoreMoves(current, searchMoves(moveBuffer, current), { 0, 0, 0 }, moveBuffer) };
+					bool evaded { false };
+					for (chess::moveData qMove; qMoves.pickBest(qMove);) {
+						if (!playable(current, qMove))
+							continue;
+						evaded = true;
+						if (searchMove(qMove))
+							return beta;
+					}
+					return evaded ? alpha : -mateValue + height;
+				}
+
+				const int standPat { evaluate() };
+				if (standPat >= beta) {
+					return beta;
+				}
+				alpha = std::max(alpha, standPat);
+				// Captures that lose material in the exchange can't raise alpha above the stand pat score, so they are not searched
+				chess::scoredMoveSlice qMoves { moveBuffer.score(searchMoves(moveBuffer, current, chess::moveGenType::captures), [&botToUse, &current](const chess::moveData capture) { return botToUse.staticExchange(current, capture); }) };
+				for (chess::moveData qMove; qMoves.pickBest(qMove, 0);) {
+					if (playable(current, qMove) && searchMove(qMove))
+						return beta;
+				}
+				if (qPly == 0) {
+					// Only generated when no capture cut off
+					for (const auto quietCheck : searchMoves(moveBuffer, current, chess::moveGenType::quietChecks)) {
+						if (playable(current, quietCheck) && searchMove(quietCheck))
+							return beta;
+					}
+				}
+				return alpha;
+			};
+
+			// The main thread can't be stopped before it has a move to return
+			auto aborted = [&stop, &output, threadIndex]() -> bool {
+				return stop.load(std::memory_order_relaxed) && (threadIndex > 0 || output.depth > 0);
+			};
+
+			auto alphaBeta = [&gameToTest, &nodes, &nextTimeCheck, &TT, &botToUse, &stop, &clock, &quiescence, &aborted, &heuristics, &moveBuffers, &makeMove, &makeNullMove, &undoMove, &evaluate, rootHistorySize, threadIndex](const auto alphaBeta, int alpha, const int beta, const int ply) -> minimaxOutput {
+				// Distance from the root, which no longer follows from ply once moves are reduced
+				const int height { static_cast<int>(gameToTest.gameHistory.size() - rootHistorySize) };
+				if (ply < 1) {
+					return { quiescence(quiescence, alpha, beta, 0, height), { 0, 0, 0 } };
+				}
+				nodes++;
+				if (threadIndex == 0 && nodes >= nextTimeCheck) {
+					nextTimeCheck = nodes + timeCheckInterval;
+					if (clock.hardLimitReached())
+						stop = true;
+				}
+				const u64 key { gameToTest.currentPosition().zobristHash };
+
+				// The root always searches, so that a move is returned
+				if (height > 0) {
+					// A repetition inside the search is scored as a draw already, the opponent could repeat it again.
+					// Checked before the table, whose score for this position doesn't know about the path that led here.
+					if (gameToTest.repetition(rootHistorySize) || gameToTest.currentPosition().halfMoveClock >= 50) {
+						return { drawValue, { 0, 0, 0 } };
+					}
+					const int ttVal = TT.lookupEval(key, ply, height, alpha, beta);
+					if (ttVal != chess::ai::transpositionTable::lookupFailed) {
+						return { ttVal, { 0, 0, 0 } };    // Only the move of the root is read
+					}
+				}
+
+				const chess::position& current { gameToTest.currentPosition() };
+				const bool inCheck { sideToMoveInCheck(current) };
+				const bool pvNode { beta - alpha > 1 };    // Every other node is searched with a null window
+
+				// Null move pruning: if passing the turn still fails high, a real move would too.
+				// Not tried twice in a row, in check, near a mate bound, or when the side to move has only pawns, where passing may really be the best move (zugzwang)
+				if (!pvNode && !inCheck && height > 0 && ply >= nullMoveMinDepth && std::abs(beta) < mateThreshold && gameToTest.gameHistory.back().move != moveData { 0, 0, 0 }) {
+					const chess::piece allyColor { current.turn() };
+					const chess::u64 allyPieces { current.bitboards[allyColor] & ~current.bitboards[chess::util::constructPiece(pawn, allyColor)] & ~current.bitboards[chess::util::constructPiece(king, allyColor)] };
+					if (allyPieces && evaluate() >= beta) {
+						makeNullMove();
+						const int nullEval { -alphaBeta(alphaBeta, -beta, -beta + 1, ply - 1 - (2 + ply / 4)).eval };
+						undoMove();
+						if (aborted()) {
+							return { 0, { 0, 0, 0 } };
+						}
+						if (nullEval >= beta) {
+							return { beta, { 0, 0, 0 } };
+						}
+					}
+				}
+
+				int evalType      = chess::ai::transpositionTable::upperBound;
+				moveData bestMove = { 0, 0, 0 };
+				const moveData hashMove { TT.getStoredMove(gameToTest.currentPosition()) };
+				chess::moveStack::frame moveBuffer { *moveBuffers };
+				chess::moveSlice rootMoves { nullptr };
+				if (height == 0) {
+					// Every root move is searched, so they are all generated and ordered up front
+					rootMoves = moveBuffer.generate(gameToTest.currentPosition());
+					botToUse.orderMoves(gameToTest.currentPosition(), rootMoves, hashMove, moveBuffer);
+					if (threadIndex > 0 && rootMoves.size() > 1) {
+						// Helpers start with a different root move after the hash move
+						std::rotate(rootMoves.begin() + 1, rootMoves.begin() + 1 + (threadIndex - 1) % (rootMoves.size() - 1), rootMoves.end());
+					}
+				}
+				const chess::moveData previousMove { height > 0 ? gameToTest.gameHistory.back().move : chess::moveData { 0, 0, 0 } };
+				chess::ai::movePicker picker { height == 0 ? chess::ai::movePicker { gameToTest.currentPosition(), botToUse, rootMoves } : chess::ai::movePicker { gameToTest.currentPosition(), botToUse, hashMove, *heuristics, previousMove, height, moveBuffer } };
+				size_t movesSearched { 0 };
+				std::array<chess::moveData, chess::constants::maxMoves> failedQuiets;
+				size_t failedQuietCount { 0 };
+				for (chess::moveData legalMove; picker.next(legalMove);) {
+					movesSearched++;
+					makeMove(legalMove);
+					// Late move reductions: quiet moves ordered late and losing captures rarely turn out best, so they are searched shallower first
+					int reduction { 0 };
+					if (movesSearched >= lateMoveMinMoves && ply >= lateMoveMinDepth && !inCheck && (isQuiet(legalMove) || picker.badCapture()) && !sideToMoveInCheck(gameToTest.currentPosition())) {
+						reduction = std::clamp(lateMoveReductions[std::min(ply, 63)][std::min<size_t>(movesSearched, 63)] - (pvNode ? 1 : 0), 0, ply - 2);
+					}
+					// Principal variation search: after the first move, prove each move is worse with a null window, and only search it fully if that fails
+					int posEval;
+					if (movesSearched == 1) {
+						posEval = -alphaBeta(alphaBeta, -beta, -alpha, ply - 1).eval;
+					} else {
+						posEval = -alphaBeta(alphaBeta, -alpha - 1, -alpha, ply - 1 - reduction).eval;
+						if (reduction > 0 && posEval > alpha) {
+							posEval = -alphaBeta(alphaBeta, -alpha - 1, -alpha, ply - 1).eval;
+						}
+						if (posEval > alpha && posEval < beta) {
+							posEval = -alphaBeta(alphaBeta, -beta, -alpha, ply - 1).eval;
+						}
+					}
+					undoMove();
+					if (aborted()) {
+						return { 0, { 0, 0, 0 } };    // Unfinished results are not stored
+					}
 
-			int evalType      = decltype(TT)::upperBound;
-            */
-			moveData bestMove = { 0, 0, 0 };
-			//botToUse.orderMoves(legalMoves, TT);    // In place sorting of legalMoves
-			for (auto legalMove : legalMoves) {
-				gameToTest.move(legalMove);
-				int posEval = -alphaBeta(alphaBeta, -beta, -alpha, ply - 1, isACapture(legalMove.flags)).eval;
-				if (ply == searchPly) {
-					std::cerr << legalMove.toString() << " : " << posEval << '\n';
+					if (posEval >= beta) {
+						if (isQuiet(legalMove))
+							heuristics->quietCutoff(legalMove, previousMove, height, ply, failedQuiets.data(), failedQuietCount);
+						TT.storeEval(key, ply, height, beta, chess::ai::transpositionTable::lowerBound, legalMove);
+						return { beta, legalMove };
+					}
+					if (isQuiet(legalMove))
+						failedQuiets[failedQuietCount++] = legalMove;
+					if (posEval > alpha) {
+						evalType = chess::ai::transpositionTable::exact;
+						alpha    = posEval;
+						bestMove = legalMove;
+					}
 				}
-				gameToTest.undo();
+				if (movesSearched == 0) {
+					return { inCheck ? -mateValue + height : -500, { 0, 0, 0 } };
+				}
+				TT.storeEval(key, ply, height, alpha, evalType, bestMove);
+				return { alpha, bestMove };
+			};
 
-				if (posEval >= beta) {
-					//TT.storeEval(ply, beta, decltype(TT)::lowerBound, bestMove);
-					return { beta, bestMove };
+			// Every other helper searches one ply deeper, so that the threads fill the table with different subtrees
+			for (int depth { 1 + static_cast<int>(threadIndex % 2) }; depth <= limits.depth; depth++) {
+				// Aspiration windows: search a narrow window around the previous score, and widen the side that fails, more each time
+				constexpr int fullAlpha { std::numeric_limits<short>::min() };
+				constexpr int fullBeta { std::numeric_limits<short>::max() };
+				const bool aspirate { depth >= aspirationMinDepth && std::abs(output.best.eval) < mateThreshold };
+				int window { aspirationWindow };
+				int alpha { aspirate ? output.best.eval - window : fullAlpha };
+				int beta { aspirate ? output.best.eval + window : fullBeta };
+				minimaxOutput result;
+				while (true) {
+					result = alphaBeta(alphaBeta, alpha, beta, depth);
+					if (aborted())
+						break;
+					window *= 2;
+					if (result.eval <= alpha && alpha != fullAlpha) {
+						alpha = window > aspirationWindow * 16 ? fullAlpha : std::max(alpha - window, fullAlpha);
+					} else if (result.eval >= beta && beta != fullBeta) {
+						beta = window > aspirationWindow * 16 ? fullBeta : std::min(beta + window, fullBeta);
+					} else {
+						break;
+					}
 				}
-				if (posEval > alpha) {
-					//evalType = decltype(TT)::exact;
-					alpha    = posEval;
-					bestMove = legalMove;
+				if (aborted()) {
+					break;    // The best move of the previous iteration is kept, as it was searched fully
+				}
+				output = { result, depth };
+				threadNodes[threadIndex].store(nodes, std::memory_order_relaxed);
+				if (threadIndex == 0) {
+					if (onIteration) {
+						size_t totalNodes { 0 };
+						for (const auto& count : threadNodes) {
+							totalNodes += count.load(std::memory_order_relaxed);
+						}
+						const auto elapsed { std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - searchStart).count() };
+						onIteration({ result.reccomendedMove, result.eval, totalNodes, depth, { 0, 0, 0 } }, elapsed);
+					}
+					if (clock.softLimitReached())
+						break;
 				}
 			}
-			//TT.storeEval(ply, alpha, evalType, bestMove);
-			return { alpha, bestMove };
+			threadNodes[threadIndex].store(nodes, std::memory_order_relaxed);
+			return output;
 		};
 
-		minimaxOutput result { 0, { 0, 0, 0 } };
-		result = alphaBeta(alphaBeta, std::numeric_limits<short>::min(), std::numeric_limits<short>::max(), searchPly, false);
+		std::vector<std::thread> helpers;
+		for (size_t threadIndex { 1 }; threadIndex < threadCount; threadIndex++) {
+			helpers.emplace_back(searchThread, threadIndex);
+		}
+		const threadOutput result { searchThread(0) };
+		stop = true;
+		for (auto& helper : helpers) {
+			helper.join();
+		}
+
+		// The second move of the principal variation is the hash move after the best move
+		chess::moveData ponderMove { 0, 0, 0 };
+		if (result.best.reccomendedMove != chess::moveData { 0, 0, 0 }) {
+			chess::position afterBestMove { rootGame.currentPosition() };
+			afterBestMove.makeMove(result.best.reccomendedMove);
+			ponderMove = TT.getStoredMove(afterBestMove);
+		}
+		return { result.best.reccomendedMove, result.best.eval, std::accumulate(threadNodes.begin(), threadNodes.end(), size_t { 0 }), result.depth, ponderMove };
+	}
+
+	searchResult search(const chess::game& rootGame, const chess::ai::bot& botToUse, chess::ai::transpositionTable& TT, const size_t threadCount, const chess::ai::searchLimits& limits = {}) {
+		chess::ai::searchSignals signals {};
+		return search(rootGame, botToUse, TT, threadCount, limits, signals);
+	}
+
+	chess::moveData bestMove(chess::game& gameToTest, const chess::ai::bot& botToUse, chess::ai::transpositionTable& TT, const size_t threadCount = defaultThreads, const chess::ai::searchLimits& limits = {}) {
+#ifdef AI_DEBUG
+		static size_t totalNodes = 0;
+#endif
+		const searchResult result { search(gameToTest, botToUse, TT, threadCount, limits) };
 		std::cerr << "resulteval:" << result.eval << "\n";
 
 #ifdef AI_DEBUG
-		std::cout << "Evaluated " << nodes << " nodes, Eval: " << result.eval << " Move:" << result.reccomendedMove.toString() << std::endl;
-		totalNodes += nodes;
+		std::cout << "Evaluated " << result.nodes << " nodes, Eval: " << result.eval << " Move:" << result.move.toString() << std::endl;
+		std::cout << "Transposition table overwrites: " << TT.getOverwrites() << std::endl;
+		totalNodes += result.nodes;
 		std::cout << "Total Nodes Thus Far:" << totalNodes << std::endl;
 #endif
-		return result.reccomendedMove;
+		return result.move;
+	}
+
+	chess::moveData bestMove(chess::game& gameToTest, const chess::ai::bot& botToUse, const chess::ai::searchLimits& limits = {}) {
+		// Kept between calls, so positions from previous searches can be reused
+		static chess::ai::transpositionTable TT { defaultHashMegabytes };
+		return bestMove(gameToTest, botToUse, TT, defaultThreads, limits);
 	}
 }    // namespace chess::ai
 
@@ -0,0 +1,347 @@
+#ifndef NMLH_CHESS_AI_NNUE_H
+#define NMLH_CHESS_AI_NNUE_H
+
+#include "chess.hpp"
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#	include <immintrin.h>
+#	define NMLH_NNUE_X86_AVAILABLE 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#	include <arm_neon.h>
+#	define NMLH_NNUE_NEON_AVAILABLE 1
+#endif
+
+// Efficiently updatable neural network evaluation.
+// Each side sees the board from its own side: every piece on a square is an input feature, bucketed by where that side's king is (HalfKA with four king buckets).
+// The features of a side sum into its accumulator, which is updated by the few features a move changes instead of being recomputed.
+// The accumulators of the side to move and of its opponent go through a clipped ReLU into a single output.
+namespace chess::ai::nnue {
+	constexpr size_t kingBuckets { 4 };
+	constexpr size_t featuresPerBucket { 12 * 64 };    // Ally pieces then opponent pieces, pawn to king, on each square
+	constexpr size_t featureCount { kingBuckets * featuresPerBucket };
+	constexpr size_t hiddenSize { 256 };
+	constexpr int activationMax { 127 };       // Quantization of the clipped ReLU, the accumulator value of 1.0
+	constexpr int outputWeightScale { 64 };    // Quantization of the output weights
+	constexpr int outputScale { 400 };         // Centipawns of an output of 1.0
+	constexpr std::array<char, 8> fileMagic { 'N', 'M', 'L', 'H', 'N', 'N', 'U', 'E' };
+	constexpr chess::u32 fileVersion { 1 };
+	static_assert(hiddenSize % 16 == 0, "The simd kernels work on 16 values at a time");
+	static_assert(std::endian::native == std::endian::little, "Network files are little endian");
+
+	struct network {
+		alignas(64) std::array<std::int16_t, featureCount * hiddenSize> featureWeights;    // One row of hiddenSize per feature
+		alignas(64) std::array<std::int16_t, hiddenSize> featureBias;
+		alignas(64) std::array<std::int8_t, 2 * hiddenSize> outputWeights;                 // The side to move's accumulator, then the opponent's
+		std::int32_t outputBias;                                                           // In units of activationMax * outputWeightScale
+	};
+
+	// The file holds the magic, then the version, hidden size and king bucket count (u32 each), then the arrays of network in order.
+	// Returns nullptr if the file can't be read or was made for a different architecture.
+	[[nodiscard]] inline std::shared_ptr<const network> load(const std::string& path) {
+		std::ifstream file { path, std::ios::binary };
+		std::array<char, 8> magic {};
+		std::array<chess::u32, 3> header {};
+		if (!file.read(magic.data(), magic.size()) || magic != fileMagic || !file.read(reinterpret_cast<char*>(header.data()), sizeof(header)))
+			return nullptr;
+		if (header[0] != fileVersion || header[1] != hiddenSize || header[2] != kingBuckets)
+			return nullptr;
+
+		auto result { std::make_shared<network>() };
+		const auto readInto = [&file](auto& target) { return static_cast<bool>(file.read(reinterpret_cast<char*>(&target), sizeof(target))); };
+		if (!readInto(result->featureWeights) || !readInto(result->featureBias) || !readInto(result->outputWeights) || !readInto(result->outputBias))
+			return nullptr;
+		return result;
+	}
+
+	// Instruction sets the accumulator updates and the output layer can use
+	enum class backend : chess::u8
+	{
+		scalar,
+		sse41,
+		avx2,
+		neon
+	};
+
+	[[nodiscard]] inline bool supported(const backend targetBackend) noexcept {
+		switch (targetBackend) {
+#ifdef NMLH_NNUE_X86_AVAILABLE
+			case backend::avx2:
+				return __builtin_cpu_supports("avx2");
+			case backend::sse41:
+				return __builtin_cpu_supports("sse4.1");
+#endif
+#ifdef NMLH_NNUE_NEON_AVAILABLE
+			case backend::neon:
+				return true;
+#endif
+			case backend::scalar:
+				return true;
+			default:
+				return false;
+		}
+	}
+	// The fastest backend that the cpu supports (picked at startup)
+	[[nodiscard]] inline backend bestBackend() noexcept {
+		for (const backend candidate : { backend::avx2, backend::neon, backend::sse41 }) {
+			if (supported(candidate))
+				return candidate;
+		}
+		return backend::scalar;
+	}
+	inline backend activeBackend { bestBackend() };
+	// Returns false, and keeps the current backend, if the cpu doesn't support the requested backend
+	inline bool select(const backend requestedBackend) noexcept {
+		if (!supported(requestedBackend))
+			return false;
+		activeBackend = requestedBackend;
+		return true;
+	}
+	[[nodiscard]] inline const char* name(const backend targetBackend) noexcept {
+		switch (targetBackend) {
+			case backend::avx2:
+				return "avx2";
+			case backend::sse41:
+				return "sse4.1";
+			case backend::neon:
+				return "neon";
+			default:
+				return "scalar";
+		}
+	}
+
+	// Vectors of hiddenSize values. The x86 kernels are compiled for their instruction set regardless of the flags of the rest of the program,
+	// and only called if the cpu supports it.
+	namespace kernels {
+		// values += row (or -= row)
+		template <bool add>
+		inline void updateScalar(std::int16_t* values, const std::int16_t* row) noexcept {
+			for (size_t index { 0 }; index < hiddenSize; index++) {
+				values[index] = static_cast<std::int16_t>(add ? values[index] + row[index] : values[index] - row[index]);
+			}
+		}
+		// Sum of clamp(values, 0, activationMax) * weights
+		inline std::int32_t activatedDotScalar(const std::int16_t* values, const std::int8_t* weights) noexcept {
+			std::int32_t result { 0 };
+			for (size_t index { 0 }; index < hiddenSize; index++) {
+				result += std::clamp<std::int32_t>(values[index], 0, activationMax) * weights[index];
+			}
+			return result;
+		}
+
+#ifdef NMLH_NNUE_X86_AVAILABLE
+		template <bool add>
+		__attribute__((target("avx2"))) inline void updateAvx2(std::int16_t* values, const std::int16_t* row) noexcept {
+			for (size_t index { 0 }; index < hiddenSize; index += 16) {
+				const __m256i current { _mm256_load_si256(reinterpret_cast<const __m256i*>(values + index)) };
+				const __m256i change { _mm256_load_si256(reinterpret_cast<const __m256i*>(row + index)) };
+				_mm256_store_si256(reinterpret_cast<__m256i*>(values + index), add ? _mm256_add_epi16(current, change) : _mm256_sub_epi16(current, change));
+			}
+		}
+		__attribute__((target("avx2"))) inline std::int32_t activatedDotAvx2(const std::int16_t* values, const std::int8_t* weights) noexcept {
+			const __m256i zero { _mm256_setzero_si256() };
+			const __m256i maximum { _mm256_set1_epi16(activationMax) };
+			__m256i sum { _mm256_setzero_si256() };
+			for (size_t index { 0 }; index < hiddenSize; index += 16) {
+				const __m256i activated { _mm256_min_epi16(_mm256_max_epi16(_mm256_load_si256(reinterpret_cast<const __m256i*>(values + index)), zero), maximum) };
+				const __m256i widenedWeights { _mm256_cvtepi8_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(weights + index))) };
+				sum = _mm256_add_epi32(sum, _mm256_madd_epi16(activated, widenedWeights));
+			}
+			__m128i halves { _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1)) };
+			halves = _mm_add_epi32(halves, _mm_shuffle_epi32(halves, 0x4E));
+			halves = _mm_add_epi32(halves, _mm_shuffle_epi32(halves, 0xB1));
+			return _mm_cvtsi128_si32(halves);
+		}
+
+		template <bool add>
+		__attribute__((target("sse4.1"))) inline void updateSse41(std::int16_t* values, const std::int16_t* row) noexcept {
+			for (size_t index { 0 }; index < hiddenSize; index += 8) {
+				const __m128i current { _mm_load_si128(reinterpret_cast<const __m128i*>(values + index)) };
+				const __m128i change { _mm_load_si128(reinterpret_cast<const __m128i*>(row + index)) };
+				_mm_store_si128(reinterpret_cast<__m128i*>(values + index), add ? _mm_add_epi16(current, change) : _mm_sub_epi16(current, change));
+			}
+		}
+		__attribute__((target("sse4.1"))) inline std::int32_t activatedDotSse41(const std::int16_t* values, const std::int8_t* weights) noexcept {
+			const __m128i zero { _mm_setzero_si128() };
+			const __m128i maximum { _mm_set1_epi16(activationMax) };
+			__m128i sum { _mm_setzero_si128() };
+			for (size_t index { 0 }; index < hiddenSize; index += 8) {
+				const __m128i activated { _mm_min_epi16(_mm_max_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(values + index)), zero), maximum) };
+				const __m128i widenedWeights { _mm_cvtepi8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(weights + index))) };
+				sum = _mm_add_epi32(sum, _mm_madd_epi16(activated, widenedWeights));
+			}
+			sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+			sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+			return _mm_cvtsi128_si32(sum);
+		}
+#endif
+
+#ifdef NMLH_NNUE_NEON_AVAILABLE
+		template <bool add>
+		inline void updateNeon(std::int16_t* values, const std::int16_t* row) noexcept {
+			for (size_t index { 0 }; index < hiddenSize; index += 8) {
+				const int16x8_t current { vld1q_s16(values + index) };
+				const int16x8_t change { vld1q_s16(row + index) };
+				vst1q_s16(values + index, add ? vaddq_s16(current, change) : vsubq_s16(current, change));
+			}
+		}
+		inline std::int32_t activatedDotNeon(const std::int16_t* values, const std::int8_t* weights) noexcept {
+			const int16x8_t zero { vdupq_n_s16(0) };
+			const int16x8_t maximum { vdupq_n_s16(activationMax) };
+			int32x4_t sum { vdupq_n_s32(0) };
+			for (size_t index { 0 }; index < hiddenSize; index += 8) {
+				const int16x8_t activated { vminq_s16(vmaxq_s16(vld1q_s16(values + index), zero), maximum) };
+				const int16x8_t widenedWeights { vmovl_s8(vld1_s8(weights + index)) };
+				sum = vmlal_s16(sum, vget_low_s16(activated), vget_low_s16(widenedWeights));
+				sum = vmlal_s16(sum, vget_high_s16(activated), vget_high_s16(widenedWeights));
+			}
+			return vaddvq_s32(sum);
+		}
+#endif
+
+		template <bool add>
+		inline void update(std::int16_t* values, const std::int16_t* row) noexcept {
+			switch (activeBackend) {
+#ifdef NMLH_NNUE_X86_AVAILABLE
+				case backend::avx2:
+					return updateAvx2<add>(values, row);
+				case backend::sse41:
+					return updateSse41<add>(values, row);
+#endif
+#ifdef NMLH_NNUE_NEON_AVAILABLE
+				case backend::neon:
+					return updateNeon<add>(values, row);
+#endif
+				default:
+					return updateScalar<add>(values, row);
+			}
+		}
+		[[nodiscard]] inline std::int32_t activatedDot(const std::int16_t* values, const std::int8_t* weights) noexcept {
+			switch (activeBackend) {
+#ifdef NMLH_NNUE_X86_AVAILABLE
+				case backend::avx2:
+					return activatedDotAvx2(values, weights);
+				case backend::sse41:
+					return activatedDotSse41(values, weights);
+#endif
+#ifdef NMLH_NNUE_NEON_AVAILABLE
+				case backend::neon:
+					return activatedDotNeon(values, weights);
+#endif
+				default:
+					return activatedDotScalar(values, weights);
+			}
+		}
+	}    // namespace kernels
+
+	// Which of the four buckets a king is in, from its own side: its own half of the board or not, and the kingside or queenside files
+	[[nodiscard]] constexpr size_t bucketOf(const chess::u8 kingSquare, const chess::piece perspective) noexcept {
+		const size_t relativeSquare { perspective == chess::piece::white ? kingSquare : kingSquare ^ 56u };
+		return (relativeSquare >= 32 ? 2 : 0) + (relativeSquare % 8 >= 4 ? 1 : 0);
+	}
+	[[nodiscard]] constexpr size_t featureIndex(const chess::piece perspective, const size_t bucket, const chess::piece boardPiece, const chess::u8 square) noexcept {
+		const size_t relativePiece { (chess::util::colorOf(boardPiece) == perspective ? 0u : 6u) + chess::util::getPieceOf(boardPiece) - 1 };
+		const size_t relativeSquare { perspective == chess::piece::white ? square : square ^ 56u };
+		return bucket * featuresPerBucket + relativePiece * 64 + relativeSquare;
+	}
+	[[nodiscard]] constexpr bool isPiece(const chess::piece boardPiece) noexcept {
+		return chess::util::getPieceOf(boardPiece) != 0 && boardPiece != chess::piece::empty;
+	}
+
+	struct accumulator {
+		alignas(64) std::array<std::array<std::int16_t, hiddenSize>, 2> values;    // [perspective >> 3]
+		std::array<size_t, 2> kingBucket;
+	};
+
+	// The accumulators of every position from the root to the current one. Owned by one search thread, and allocated before it searches.
+	// Moves have to be made and taken back through it, so that it follows the game.
+	class accumulatorStack {
+	public:
+		accumulatorStack(const network& evaluationNetwork, const chess::position& root, const size_t maxHeight) :
+			evaluationNetwork { &evaluationNetwork }, stack(maxHeight + 1), top { 0 } {
+			this->refresh(this->stack[0], root, chess::piece::black);
+			this->refresh(this->stack[0], root, chess::piece::white);
+		}
+
+		void move(chess::game& gameToUpdate, const chess::moveData desiredMove) noexcept {
+			struct squareChange {
+				chess::u8 square;
+				chess::piece before;
+			};
+			std::array<squareChange, 4> changes;
+			size_t changeCount { 0 };
+			chess::forEachChangedSquare(desiredMove, [&changes, &changeCount, &gameToUpdate](const chess::u8 changedSquare) {
+				changes[changeCount++] = { changedSquare, gameToUpdate.currentPosition().pieceAtIndex[changedSquare] };
+			});
+			gameToUpdate.move(desiredMove);
+
+			const chess::position& after { gameToUpdate.currentPosition() };
+			const accumulator& previous { this->stack[this->top] };
+			accumulator& next { this->stack[++this->top] };
+			for (const chess::piece perspective : { chess::piece::black, chess::piece::white }) {
+				const size_t side { static_cast<size_t>(perspective >> 3) };
+				const size_t bucket { bucketOf(chess::util::ctz64(after.bitboards[chess::util::constructPiece(chess::piece::king, perspective)]), perspective) };
+				if (bucket != previous.kingBucket[side]) {
+					// Every feature of this side changes with its king bucket
+					this->refresh(next, after, perspective);
+					continue;
+				}
+				next.values[side]     = previous.values[side];
+				next.kingBucket[side] = bucket;
+				for (size_t index { 0 }; index < changeCount; index++) {
+					const auto [square, before] { changes[index] };
+					if (isPiece(before))
+						kernels::update<false>(next.values[side].data(), this->row(featureIndex(perspective, bucket, before, square)));
+					if (isPiece(after.pieceAtIndex[square]))
+						kernels::update<true>(next.values[side].data(), this->row(featureIndex(perspective, bucket, after.pieceAtIndex[square], square)));
+				}
+			}
+		}
+		void nullMove(chess::game& gameToUpdate) noexcept {
+			gameToUpdate.nullMove();
+			this->stack[this->top + 1] = this->stack[this->top];
+			this->top++;
+		}
+		void undo(chess::game& gameToUpdate) noexcept {
+			gameToUpdate.undo();
+			this->top--;
+		}
+
+		// Centipawns for the side to move of the current position
+		[[nodiscard]] int evaluate(const chess::position& current) const noexcept {
+			const accumulator& currentAccumulator { this->stack[this->top] };
+			const size_t us { static_cast<size_t>(current.turn() >> 3) };
+			const std::int32_t output { kernels::activatedDot(currentAccumulator.values[us].data(), this->evaluationNetwork->outputWeights.data()) +
+				                        kernels::activatedDot(currentAccumulator.values[us ^ 1].data(), this->evaluationNetwork->outputWeights.data() + hiddenSize) +
+				                        this->evaluationNetwork->outputBias };
+			return static_cast<int>(static_cast<long long>(output) * outputScale / (activationMax * outputWeightScale));
+		}
+
+	private:
+		const network* evaluationNetwork;
+		std::vector<accumulator> stack;
+		size_t top;
+
+		[[nodiscard]] const std::int16_t* row(const size_t feature) const noexcept {
+			return this->evaluationNetwork->featureWeights.data() + feature * hiddenSize;
+		}
+		void refresh(accumulator& target, const chess::position& source, const chess::piece perspective) const noexcept {
+			const size_t side { static_cast<size_t>(perspective >> 3) };
+			const size_t bucket { bucketOf(chess::util::ctz64(source.bitboards[chess::util::constructPiece(chess::piece::king, perspective)]), perspective) };
+			target.values[side]     = this->evaluationNetwork->featureBias;
+			target.kingBucket[side] = bucket;
+			for (chess::u64 pieces { source.bitboards[chess::piece::occupied] }; pieces; pieces &= pieces - 1) {
+				const chess::u8 square { static_cast<chess::u8>(chess::util::ctz64(pieces)) };
+				kernels::update<true>(target.values[side].data(), this->row(featureIndex(perspective, bucket, source.pieceAtIndex[square], square)));
+			}
+		}
+	};
+}    // namespace chess::ai::nnue
+
+#endif    // NMLH_CHESS_AI_NNUE_H
@@ -5,10 +5,14 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <limits>
+#include <utility>
+#include <cassert>
 
 #include "chess_types.hpp"
 #include "chess_constants.hpp"
 #include "chess_utils.hpp"
+#include "chess_sliders.hpp"
 
 namespace chess {
 	struct moveData {
@@ -33,24 +37,149 @@ namespace chess {
 		return lhs.originIndex == rhs.originIndex && lhs.destinationIndex == rhs.destinationIndex && lhs.flags == rhs.flags;
 	};
 
+	// Calls updateSquare on every square whose piece is changed by the move
+	template <typename squareFunction>
+	inline void forEachChangedSquare(const chess::moveData desiredMove, const squareFunction updateSquare) noexcept {
+		updateSquare(desiredMove.originIndex);
+		updateSquare(desiredMove.destinationIndex);
+		switch (desiredMove.moveFlags()) {
+			case 0x2000:    // White Kingside
+				updateSquare(h1);
+				updateSquare(f1);
+				break;
+			case 0x3000:    // White Queenside
+				updateSquare(a1);
+				updateSquare(d1);
+				break;
+			case 0x4000:    // Black Kingside
+				updateSquare(h8);
+				updateSquare(f8);
+				break;
+			case 0x5000:    // Black Queenside
+				updateSquare(a8);
+				updateSquare(d8);
+				break;
+			case 0x6000:    // White taking black en passent
+				updateSquare(desiredMove.destinationIndex - 8);
+				break;
+			case 0x7000:    // Black taking white en passent
+				updateSquare(desiredMove.destinationIndex + 8);
+				break;
+			default:
+				break;
+		}
+	}
+
+	// Moves in storage owned by the caller, such as a chess::moveList or a slice of a chess::moveStack
+	class moveSlice {
+	public:
+		explicit moveSlice(chess::moveData* first) noexcept :
+			first { first }, insertLocation { first } {}
+		inline void append(const chess::moveData& moveToInsert) noexcept { *(insertLocation++) = moveToInsert; }
+		[[nodiscard]] inline chess::moveData& operator[](std::size_t index) const noexcept { return first[index]; }
+		[[nodiscard]] inline chess::moveData* begin() const noexcept { return first; }
+		[[nodiscard]] inline chess::moveData* end() const noexcept { return insertLocation; }
+		[[nodiscard]] inline chess::u64 size() const noexcept { return static_cast<chess::u64>(insertLocation - first); }
+
+	private:
+		chess::moveData* first;
+		chess::moveData* insertLocation;
+	};
+
 	class moveList {
 	public:
-		moveList() :
-			moves {}, insertLocation { moves.data() } {}
-		moveList(const moveList& other) :
-			moves { other.moves }, insertLocation { (this->moves.data() - other.moves.data()) + other.insertLocation } {}
+		// Only the moves up to size() are ever read, so the storage isn't cleared
+		moveList() noexcept { this->insertLocation = this->moves.data(); }
+		moveList(const moveList& other) noexcept { this->insertLocation = std::copy(other.begin(), other.end(), this->moves.data()); }
+		moveList& operator=(const moveList& other) noexcept {
+			std::copy(other.moves.begin(), other.moves.begin() + other.size(), this->moves.begin());
+			this->insertLocation = this->moves.data() + other.size();
+			return *this;
+		}
 		inline void append(const chess::moveData& moveToInsert) noexcept { *(insertLocation++) = moveToInsert; }
 		inline void pop() noexcept { --insertLocation; }
 		[[nodiscard]] inline chess::moveData& operator[](std::size_t index) noexcept { return moves[index]; }
 		[[nodiscard]] inline chess::moveData* begin() noexcept { return moves.data(); }
 		[[nodiscard]] inline chess::moveData* end() noexcept { return insertLocation; }
+		[[nodiscard]] inline const chess::moveData* begin() const noexcept { return moves.data(); }
+		[[nodiscard]] inline const chess::moveData* end() const noexcept { return insertLocation; }
 		[[nodiscard]] inline chess::u64 size() const noexcept { return static_cast<chess::u64>(insertLocation - moves.data()); }
+		// Takes the moves generated into begin()
+		inline void assign(const chess::moveSlice& generated) noexcept { insertLocation = generated.end(); }
 
 	private:
 		std::array<chess::moveData, chess::constants::maxMoves> moves;
 		chess::moveData* insertLocation;
 	};
 
+	// Moves in caller owned storage with an ordering score next to each (in a parallel array), handed out highest score first.
+	// The best remaining move is only searched for when it is asked for, so a node that cuts off early never sorts the rest.
+	// Moves are swapped into place as they are handed out, so once every move has been picked the storage is sorted.
+	class scoredMoveSlice {
+	public:
+		scoredMoveSlice(chess::moveData* moves, int* scores, const chess::u64 moveCount) noexcept :
+			moves { moves }, scores { scores }, moveCount { moveCount }, pickedCount { 0 } {}
+		// Hands out the best move not handed out yet, unless it scores below minimumScore. Equal scores come out in the order they were added.
+		[[nodiscard]] bool pickBest(chess::moveData& result, const int minimumScore = std::numeric_limits<int>::min()) noexcept {
+			if (this->pickedCount == this->moveCount)
+				return false;
+			chess::u64 best { this->pickedCount };
+			for (chess::u64 candidate { best + 1 }; candidate < this->moveCount; candidate++) {
+				if (this->scores[candidate] > this->scores[best])
+					best = candidate;
+			}
+			if (this->scores[best] < minimumScore)
+				return false;
+			std::swap(this->moves[best], this->moves[this->pickedCount]);
+			std::swap(this->scores[best], this->scores[this->pickedCount]);
+			result = this->moves[this->pickedCount++];
+			return true;
+		}
+		[[nodiscard]] inline chess::u64 size() const noexcept { return this->moveCount; }
+
+	private:
+		chess::moveData* moves;
+		int* scores;
+		chess::u64 moveCount;
+		chess::u64 pickedCount;    // Moves already handed out, kept at the front
+	};
+
+	// Midgame score, endgame score and game phase, from white's point of view
+	struct evalAccumulator {
+		int midgame;
+		int endgame;
+		int phase;
+		constexpr evalAccumulator& operator+=(const evalAccumulator& other) noexcept {
+			this->midgame += other.midgame;
+			this->endgame += other.endgame;
+			this->phase += other.phase;
+			return *this;
+		}
+		constexpr evalAccumulator& operator-=(const evalAccumulator& other) noexcept {
+			this->midgame -= other.midgame;
+			this->endgame -= other.endgame;
+			this->phase -= other.phase;
+			return *this;
+		}
+		friend constexpr bool operator==(const evalAccumulator&, const evalAccumulator&) = default;
+	};
+	// Score of each piece on each square. A position keeps the sum over its pieces up to date as moves are made, like its zobrist hash.
+	// Each evaluation owns its table, and a position refers to the one it is scored with.
+	using pieceSquareScores = std::array<std::array<chess::evalAccumulator, 64>, 16>;
+	// Scores nothing, positions are set up with it until an evaluation gives them its own
+	inline constexpr chess::pieceSquareScores noPieceSquareScores {};
+
+	// Everything position::unmakeMove() needs to restore the position from before a move, other than the move itself
+	struct undoRecord {
+		chess::u64 enPassantTargetBitboard;
+		chess::u64 zobristHash;
+		chess::u64 pawnHash;
+		chess::evalAccumulator evaluation;
+		chess::u16 fullMoveClock;
+		chess::u8 flags;
+		chess::u8 halfMoveClock;
+	};
+
 	struct position {
 		std::array<chess::u64, 16> bitboards;
 		std::array<chess::piece, 64> pieceAtIndex;
@@ -59,11 +188,31 @@ namespace chess {
 		chess::u8 halfMoveClock;
 		chess::u64 enPassantTargetBitboard;
 		chess::u64 zobristHash;
+		chess::u64 pawnHash;                  // Zobrist hash of the pawns alone, for caching pawn structure
+		chess::evalAccumulator evaluation;    // Sum of *scoreTable over the pieces
 		chess::u16 fullMoveClock;
+		const chess::pieceSquareScores* scoreTable { &chess::noPieceSquareScores };
 
-		template <chess::piece allyColor>
-		[[nodiscard]] chess::moveList moves() const noexcept;
+		[[nodiscard]] chess::moveList moves(chess::moveGenType genType = chess::moveGenType::all) const noexcept;
+		// Writes the moves to caller owned storage with room for chess::constants::maxMoves, starting at out
+		[[nodiscard]] chess::moveSlice moves(chess::moveData* out, chess::moveGenType genType = chess::moveGenType::all) const noexcept;
+		template <chess::piece allyColor, chess::moveGenType genType = chess::moveGenType::all>
+		[[nodiscard]] chess::moveSlice moves(chess::moveData* out) const noexcept;
+		// Moves that may leave the king in check, each one is checked with isLegal only once it is about to be played
+		[[nodiscard]] chess::moveSlice pseudoLegalMoves(chess::moveData* out, chess::moveGenType genType = chess::moveGenType::all) const noexcept;
+		template <chess::piece allyColor, chess::moveGenType genType = chess::moveGenType::all>
+		[[nodiscard]] chess::moveSlice pseudoLegalMoves(chess::moveData* out) const noexcept;
+		[[nodiscard]] bool isLegal(moveData pseudoLegalMove) const noexcept;
+		[[nodiscard]] moveData pseudoLegalMove(chess::square origin, chess::square destination, chess::piece promotionType) const noexcept;
+		[[nodiscard]] bool givesCheck(moveData legalMove) const noexcept;
+		// Copy-make
 		[[nodiscard]] position move(moveData desiredMove) const noexcept;
+		// Make/unmake in place
+		chess::undoRecord makeMove(moveData desiredMove) noexcept;
+		void unmakeMove(moveData desiredMove, const chess::undoRecord& undo) noexcept;
+		// Passes the turn without moving a piece (for null move pruning)
+		chess::undoRecord makeNullMove() noexcept;
+		void unmakeNullMove(const chess::undoRecord& undo) noexcept;
 		template <chess::piece attackingColor>
 		[[nodiscard]] chess::u64 attacks() const noexcept;
 		template <chess::piece attackingColor>
@@ -74,35 +223,38 @@ namespace chess {
 			       (this->pieceMoves<knight>(targetSquare, this->bitboards[occupied]) & this->bitboards[constructPiece(knight, attackingColor)]) |
 			       (constants::pawnAttacks[~attackingColor >> 3][targetSquare] & this->bitboards[constructPiece(pawn, attackingColor)]);
 		}
+		// Attackers of both colours including kings, through occupiedSquares, so that taking pieces off it reveals the sliders behind them
+		[[nodiscard]] chess::u64 attackersTo(const chess::square targetSquare, const chess::u64 occupiedSquares) const noexcept {
+			using namespace chess::util;
+			return (this->pieceMoves<bishop>(targetSquare, occupiedSquares) & (this->bitboards[whiteBishop] | this->bitboards[blackBishop] | this->bitboards[whiteQueen] | this->bitboards[blackQueen])) |
+			       (this->pieceMoves<rook>(targetSquare, occupiedSquares) & (this->bitboards[whiteRook] | this->bitboards[blackRook] | this->bitboards[whiteQueen] | this->bitboards[blackQueen])) |
+			       (this->pieceMoves<knight>(targetSquare, occupiedSquares) & (this->bitboards[whiteKnight] | this->bitboards[blackKnight])) |
+			       (this->pieceMoves<king>(targetSquare, occupiedSquares) & (this->bitboards[whiteKing] | this->bitboards[blackKing])) |
+			       (constants::pawnAttacks[black >> 3][targetSquare] & this->bitboards[whitePawn]) |
+			       (constants::pawnAttacks[white >> 3][targetSquare] & this->bitboards[blackPawn]);
+		}
+		// Static exchange evaluation: material won by the side to move from the move and the trades that follow on its destination
+		[[nodiscard]] int staticExchange(moveData legalMove, const int (&pieceValues)[16]) const noexcept;
 		template <chess::piece defendingColor>
 		[[nodiscard]] bool inCheck() const noexcept {
 			return static_cast<bool>(this->attackers<static_cast<chess::piece>(defendingColor ^ chess::piece::white)>(chess::util::ctz64(this->bitboards[chess::util::constructPiece(chess::piece::king, defendingColor)])));
 		}
 		template <chess::piece targetPiece>
-		[[nodiscard]] inline chess::u64 pieceMoves(const u8 squareFrom, const u64 occupied) const noexcept { return chess::u64 {}; };
-		template <>
-		[[nodiscard]] inline chess::u64 pieceMoves<chess::piece::bishop>(const chess::u8 squareFrom, const u64 occupied) const noexcept {
-			return chess::util::positiveRayAttacks<chess::northWest>(squareFrom, occupied) | chess::util::positiveRayAttacks<chess::northEast>(squareFrom, occupied) | chess::util::negativeRayAttacks<chess::southWest>(squareFrom, occupied) | chess::util::negativeRayAttacks<chess::southEast>(squareFrom, occupied);
-		}
-		template <>
-		[[nodiscard]] inline chess::u64 pieceMoves<chess::piece::rook>(const chess::u8 squareFrom, const u64 occupied) const noexcept {
-			return chess::util::positiveRayAttacks<chess::north>(squareFrom, occupied) | chess::util::positiveRayAttacks<chess::west>(squareFrom, occupied) | chess::util::negativeRayAttacks<chess::south>(squareFrom, occupied) | chess::util::negativeRayAttacks<chess::east>(squareFrom, occupied);
-		}
-		template <>
-		[[nodiscard]] inline chess::u64 pieceMoves<chess::piece::knight>(const chess::u8 squareFrom, const u64 occupied) const noexcept {
-			return chess::constants::knightJumps[squareFrom];
-		}
-		template <>
-		[[nodiscard]] inline chess::u64 pieceMoves<chess::piece::queen>(const chess::u8 squareFrom, const u64 occupied) const noexcept {
-			return this->pieceMoves<chess::piece::rook>(squareFrom, occupied) | this->pieceMoves<chess::piece::bishop>(squareFrom, occupied);
-		}
-		template <>
-		[[nodiscard]] inline chess::u64 pieceMoves<chess::piece::king>(const chess::u8 squareFrom, const u64 occupied) const noexcept {
-			return chess::constants::kingAttacks[squareFrom];
+		[[nodiscard]] inline chess::u64 pieceMoves(const u8 squareFrom, const u64 occupied) const noexcept {
+			if constexpr (targetPiece == chess::piece::bishop || targetPiece == chess::piece::rook)
+				return chess::sliders::attacks<targetPiece>(squareFrom, occupied);
+			else if constexpr (targetPiece == chess::piece::queen)
+				return chess::sliders::attacks<chess::piece::rook>(squareFrom, occupied) | chess::sliders::attacks<chess::piece::bishop>(squareFrom, occupied);
+			else if constexpr (targetPiece == chess::piece::knight)
+				return chess::constants::knightJumps[squareFrom];
+			else if constexpr (targetPiece == chess::piece::king)
+				return chess::constants::kingAttacks[squareFrom];
+			else
+				return chess::u64 {};
 		}
 
 		template <chess::piece targetPiece>
-		void generatePieceMoves(chess::moveList& legalMoves, const chess::u64 pinnedPieces, const chess::u64 notAlly, const chess::u64 mask = chess::constants::bitboardFull) const noexcept;
+		void generatePieceMoves(chess::moveSlice& legalMoves, const chess::u64 pinnedPieces, const chess::u64 notAlly, const chess::u64 mask = chess::constants::bitboardFull) const noexcept;
 
 		[[nodiscard]] std::string ascii() const noexcept;
 		[[nodiscard]] constexpr chess::piece turn() const noexcept { return static_cast<chess::piece>(flags & 0x08); }    // 0 - 1 (1 bit)
@@ -112,11 +264,42 @@ namespace chess {
 		[[nodiscard]] constexpr bool castleWQ() const noexcept { return flags & 0x40; }
 		[[nodiscard]] constexpr bool castleBK() const noexcept { return flags & 0x20; }
 		[[nodiscard]] constexpr bool castleBQ() const noexcept { return flags & 0x10; }
+		[[nodiscard]] constexpr chess::u64 zobristState() const noexcept {
+			return (this->turn() == chess::piece::white ? chess::constants::zobristWhiteToMove : 0) ^
+			       chess::constants::zobristCastling[this->flags >> 4] ^
+			       (this->enPassantTargetBitboard ? chess::constants::zobristEnPassant[chess::util::ctz64(this->enPassantTargetBitboard) % 8] : 0);
+		}
+		[[nodiscard]] constexpr chess::u64 computeZobrist() const noexcept {
+			chess::u64 result = this->zobristState();
+			for (size_t index = 0; index < 64; index++) {
+				result ^= chess::constants::zobristBitStrings[index][pieceAtIndex[index]];
+			}
+			return result;
+		}
+		[[nodiscard]] constexpr chess::u64 computePawnHash() const noexcept {
+			chess::u64 result = 0;
+			for (size_t index = 0; index < 64; index++) {
+				if (chess::util::getPieceOf(pieceAtIndex[index]) == chess::piece::pawn)
+					result ^= chess::constants::zobristBitStrings[index][pieceAtIndex[index]];
+			}
+			return result;
+		}
 		constexpr void setZobrist() noexcept {
-			this->zobristHash = 0;
+			this->zobristHash = this->computeZobrist();
+			this->pawnHash    = this->computePawnHash();
+		}
+		[[nodiscard]] chess::evalAccumulator computeEvaluation() const noexcept {
+			chess::evalAccumulator result {};
 			for (size_t index = 0; index < 64; index++) {
-				this->zobristHash ^= chess::constants::zobristBitStrings[index][pieceAtIndex[index]];
+				result += (*this->scoreTable)[pieceAtIndex[index]][index];
 			}
+			return result;
+		}
+		void setEvaluation() noexcept { this->evaluation = this->computeEvaluation(); }
+		// Scores the position, and the positions made from it, with another table (which has to outlive them)
+		void setEvaluation(const chess::pieceSquareScores& scores) noexcept {
+			this->scoreTable = &scores;
+			this->setEvaluation();
 		}
 
 		[[nodiscard]] std::string toFen() const noexcept;
@@ -125,28 +308,123 @@ namespace chess {
 		[[nodiscard]] static bool validateFen(const std::string& fen) noexcept;
 	};
 
+	// Built with CHESS_PSEUDO_LEGAL, the search generates pseudo-legal moves and checks the legality of only those it plays
+#ifdef CHESS_PSEUDO_LEGAL
+	inline constexpr bool pseudoLegalGeneration { true };
+#else
+	inline constexpr bool pseudoLegalGeneration { false };
+#endif
+
+	// Move storage for every ply of a search (or perft) that is in progress, allocated once for each thread.
+	// Each ply generates into the space after its parent's moves, and gives it back when it returns.
+	class moveStack {
+	public:
+		// Room for maxPlies plies, each generating up to maxGenerationsPerPly times
+		moveStack(const size_t maxPlies, const size_t maxGenerationsPerPly = 2) :
+			storage(maxPlies * maxGenerationsPerPly * chess::constants::maxMoves), scores(storage.size()), top { storage.data() } {}
+		moveStack(const moveStack&)            = delete;
+		moveStack& operator=(const moveStack&) = delete;
+
+		// The moves generated through a frame are given back when it goes out of scope
+		class frame {
+		public:
+			explicit frame(moveStack& stack) noexcept :
+				stack { stack }, base { stack.top } {}
+			~frame() { this->stack.top = this->base; }
+			frame(const frame&)            = delete;
+			frame& operator=(const frame&) = delete;
+
+			[[nodiscard]] chess::moveSlice generate(const chess::position& toGenerate, const chess::moveGenType genType = chess::moveGenType::all) noexcept {
+				return this->claim(toGenerate.moves(this->space(), genType));
+			}
+			[[nodiscard]] chess::moveSlice generatePseudoLegal(const chess::position& toGenerate, const chess::moveGenType genType = chess::moveGenType::all) noexcept {
+				return this->claim(toGenerate.pseudoLegalMoves(this->space(), genType));
+			}
+			// Scores moves generated through this frame into the stack's scores next to them, to be picked best first
+			template <typename scoreFunction>
+			[[nodiscard]] chess::scoredMoveSlice score(const chess::moveSlice& generated, const scoreFunction& scoreMove) noexcept {
+				int* const scores { this->stack.scores.data() + (generated.begin() - this->stack.storage.data()) };
+				for (chess::u64 index { 0 }; index < generated.size(); index++) {
+					scores[index] = scoreMove(generated[index]);
+				}
+				return { generated.begin(), scores, generated.size() };
+			}
+
+		private:
+			[[nodiscard]] chess::moveData* space() const noexcept {
+#ifdef CHESS_DEBUG
+				assert(this->stack.top + chess::constants::maxMoves <= this->stack.storage.data() + this->stack.storage.size());
+#endif
+				return this->stack.top;
+			}
+			chess::moveSlice claim(const chess::moveSlice& generated) noexcept {
+				this->stack.top = generated.end();
+				return generated;
+			}
+
+			moveStack& stack;
+			chess::moveData* const base;
+		};
+
+	private:
+		std::vector<chess::moveData> storage;
+		std::vector<int> scores;    // Ordering score of the move at the same index of storage
+		chess::moveData* top;
+	};
+
 	struct game {
-		std::vector<position> gameHistory;
+		struct historyEntry {
+			chess::moveData move;
+			chess::undoRecord undo;
+		};
+		chess::position current;
+		std::vector<historyEntry> gameHistory;
+		std::vector<chess::u64> repetitionKeys;    // Zobrist hash of the position before each move in gameHistory, packed together for repetition scans
+		std::vector<size_t> nullMoveHeights;       // Size of gameHistory before each null move in it, no repetition reaches back past one
 
+	private:
+		// Legal move count of the position with the key, for finished()
+		struct moveCountEntry {
+			chess::u64 key;
+			size_t count;
+			bool valid;
+		};
+		mutable moveCountEntry moveCountCache;
+
+	public:
 		game(const std::string& fen) noexcept :
-			gameHistory { { chess::position::fromFen(fen) } } {}
+			current { chess::position::fromFen(fen) }, gameHistory {}, repetitionKeys {}, nullMoveHeights {}, moveCountCache { 0, 0, false } {}
 
 		[[nodiscard]] chess::moveList moves() const noexcept;
 		template <chess::piece allyColor>
 		[[nodiscard]] chess::moveList moves() const noexcept;
+		[[nodiscard]] size_t moveCount() const noexcept {
+			if (!this->moveCountCache.valid || this->moveCountCache.key != this->current.zobristHash)
+				this->moveCountCache = { this->current.zobristHash, this->current.moves().size(), true };
+			return this->moveCountCache.count;
+		}
 		[[nodiscard]] constexpr u8 result() const noexcept { return 0; };    // unused
-		[[nodiscard]] constexpr bool finished() const noexcept { return this->threeFoldRep() || this->moves().size() == 0; }
-		[[nodiscard]] constexpr bool threeFoldRep() const noexcept {
-			size_t count = 0;
-			for (size_t i = 0; i < gameHistory.size(); i += 2) {
-				if (gameHistory[i].zobristHash == gameHistory.back().zobristHash)
-					count++;
+		[[nodiscard]] bool finished() const noexcept { return this->threeFoldRep() || this->moveCount() == 0; }
+		// Whether the position repeats one played after searchStart (a gameHistory size), or two played at all.
+		// Only positions since the last capture, pawn move or null move can repeat, so the scan is bounded by the half move clock.
+		[[nodiscard]] bool repetition(const size_t searchStart) const noexcept {
+			const size_t historySize { this->repetitionKeys.size() };
+			const size_t reversiblePlies { std::min<size_t>(this->current.halfMoveClock, historySize - (this->nullMoveHeights.empty() ? 0 : this->nullMoveHeights.back() + 1)) };
+			size_t count { 0 };
+			// Both sides need to move twice to get back to a position
+			for (size_t distance { 4 }; distance <= reversiblePlies; distance += 2) {
+				const size_t index { historySize - distance };
+				if (this->repetitionKeys[index] == this->current.zobristHash && (index >= searchStart || ++count >= 2))
+					return true;
 			}
-			return count >= 3;
+			return false;
 		}
-		[[nodiscard]] inline const position& currentPosition() const noexcept { return gameHistory.back(); }
+		[[nodiscard]] bool threeFoldRep() const noexcept { return this->repetition(this->repetitionKeys.size()); }
+		[[nodiscard]] inline const position& currentPosition() const noexcept { return current; }
 		void move(const moveData desiredMove) noexcept;
 		void move(const std::string& uciMove) noexcept;
+		// Kept in the history as a null moveData, so undo() can take it back like any other move
+		void nullMove() noexcept;
 		bool undo() noexcept;
 	};
 
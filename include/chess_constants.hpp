@@ -6,7 +6,7 @@
 namespace chess::constants {
 	constexpr chess::u64 bitboardFull { 0xFFFFFFFFFFFFFFFFULL };
 	constexpr chess::u64 bitboardIter { 1ULL << 63 };
-    constexpr chess::u64 maxMoves { 218 }; // Maximum number of moves reachable in a position
+    constexpr chess::u64 maxMoves { 256 }; // Room for the moves of a position, pseudo-legal moves can go past the 218 legal moves reachable
 
 	namespace {
 		constexpr std::array<std::array<chess::u64, 64>, 8> generateAttackRays() {
@@ -77,30 +77,47 @@ namespace chess::constants {
 			return resultAttacks;
 		}
 
-		constexpr std::array<std::array<chess::u64, 16>, 64> generateZobristBitStrings() {
-			constexpr auto time_from_string { [](const char* str, int offset) {
-				return static_cast<std::uint32_t>(str[offset] - '0') * 10 + static_cast<std::uint32_t>(str[offset + 1] - '0');
-			} };
+		// Seed the random number generation
+		// This must not depend on the compile time, as every translation unit has to generate the same bit strings
+		constexpr chess::u64 zobristSeed() {
+			return 0x001F2E3D4C5B6A79ULL;
+		}
+
+		// Produces the next bit string from the previous value of the generator
+		constexpr chess::u64 nextZobristBitString(chess::u64& previous) {
+			chess::u64 result = previous;
+			previous          = ((137 * previous + 457) % 922372036854775808ULL);
+			result ^= previous << 16;
+			previous = ((137 * previous + 457) % 922372036854775808ULL);
+			result ^= previous << 32;
+			previous = ((137 * previous + 457) % 922372036854775808ULL);
+			return result;
+		}
 
+		constexpr std::array<std::array<chess::u64, 16>, 64> generateZobristBitStrings() {
 			std::array<std::array<chess::u64, 16>, 64> result {};
-			// Seed the random number generation
-			auto previous = [&time_from_string]() -> chess::u64 {
-				return time_from_string(__TIME__, 0) * 360  /* hours */
-				       + time_from_string(__TIME__, 3) * 60 /* minutes */
-				       + time_from_string(__TIME__, 6) /* seconds */;
-			}();
+			auto previous = zobristSeed();
 			for (auto& targetSquare : result) {
 				for (auto& targetPiece : targetSquare) {
-					targetPiece = previous;
-					previous    = ((137 * previous + 457) % 922372036854775808ULL);
-					targetPiece ^= previous << 16;
-					previous = ((137 * previous + 457) % 922372036854775808ULL);
-					targetPiece ^= previous << 32;
-					previous = ((137 * previous + 457) % 922372036854775808ULL);
+					targetPiece = nextZobristBitString(previous);
 				}
 			}
 			return result;
 		}
+
+		// Bit strings that continue the sequence after the piece bit strings
+		template <std::size_t count>
+		constexpr std::array<chess::u64, count> generateZobristStateBitStrings(const std::size_t offset) {
+			std::array<chess::u64, count> result {};
+			auto previous = zobristSeed();
+			for (std::size_t skip { 0 }; skip < 64 * 16 + offset; skip++) {
+				nextZobristBitString(previous);
+			}
+			for (auto& bitString : result) {
+				bitString = nextZobristBitString(previous);
+			}
+			return result;
+		}
 	}    // namespace
 
 	constexpr std::array<std::array<chess::u64, 64>, 8> attackRays { generateAttackRays() };
@@ -109,6 +126,9 @@ namespace chess::constants {
 	constexpr std::array<std::array<chess::u64, 64>, 2> pawnAttacks { generatePawnAttacks() };
 
 	constexpr std::array<std::array<chess::u64, 16>, 64> zobristBitStrings { generateZobristBitStrings() };
+	constexpr chess::u64 zobristWhiteToMove { generateZobristStateBitStrings<1>(0)[0] };
+	constexpr std::array<chess::u64, 16> zobristCastling { generateZobristStateBitStrings<16>(1) };    // Indexed by the castling nibble of position::flags
+	constexpr std::array<chess::u64, 8> zobristEnPassant { generateZobristStateBitStrings<8>(17) };    // Indexed by file (square % 8)
 }    // namespace chess::constants
 
 #endif    // NMLH_CHESS_CONSTANTS_HPP
\ No newline at end of file
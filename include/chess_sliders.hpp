@@ -0,0 +1,102 @@
+#ifndef NMLH_CHESS_SLIDERS_HPP
+#define NMLH_CHESS_SLIDERS_HPP
+
+#include <array>
+
+#include "chess_types.hpp"
+#include "chess_constants.hpp"
+#include "chess_utils.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#	include <immintrin.h>
+#	define NMLH_CHESS_PEXT_AVAILABLE 1
+#	define NMLH_CHESS_AVX2_AVAILABLE 1
+#endif
+
+namespace chess::sliders {
+	// Ways of finding the attacks of a bishop or rook
+	enum class backend : chess::u8
+	{
+		rays,     // Bit scan along each of the four rays
+		magic,    // Fancy magic bitboards
+		pext      // BMI2 parallel bit extract, only on cpus that support it
+	};
+
+	struct sliderEntry {
+		const chess::u64* magicAttacks;
+		const chess::u64* pextAttacks;
+		chess::u64 mask;     // Relevant occupancy, excludes the edges of the board
+		chess::u64 magic;
+		chess::u8 shift;
+	};
+
+	// Filled in at startup, before that every lookup uses the rays backend
+	extern std::array<sliderEntry, 64> bishopEntries;
+	extern std::array<sliderEntry, 64> rookEntries;
+	extern backend activeBackend;
+
+	[[nodiscard]] bool pextSupported() noexcept;
+	// The fastest backend that the cpu supports (picked at startup)
+	[[nodiscard]] backend bestBackend() noexcept;
+	// Returns false, and keeps the current backend, if the cpu doesn't support the requested backend
+	bool select(backend requestedBackend) noexcept;
+	[[nodiscard]] const char* name(backend targetBackend) noexcept;
+
+	// Attacks of a set of sliders along each direction, indexed by chess::attackRayDirection
+	using directionMaps = std::array<chess::u64, 8>;
+
+	// Ways of filling the attacks of every slider at once
+	enum class fillBackend : chess::u8
+	{
+		scalar,    // One direction at a time
+		avx2       // Four directions side by side, only on cpus that support it
+	};
+	extern fillBackend activeFillBackend;
+
+	[[nodiscard]] bool avx2Supported() noexcept;
+	bool select(fillBackend requestedBackend) noexcept;
+	[[nodiscard]] const char* name(fillBackend targetBackend) noexcept;
+
+	// Kogge-Stone occluded fills of every orthogonal and diagonal slider at once, with no loop over the pieces.
+	// A king's own maps (passed as both kinds of slider) meet the opposite direction maps of the opponent's sliders on the squares between them, which finds pins and x-rays.
+	[[nodiscard]] directionMaps directionalAttacks(chess::u64 orthogonalSliders, chess::u64 diagonalSliders, chess::u64 occupied) noexcept;
+	// Union of the directionalAttacks
+	[[nodiscard]] chess::u64 setwiseAttacks(chess::u64 orthogonalSliders, chess::u64 diagonalSliders, chess::u64 occupied) noexcept;
+
+#ifdef NMLH_CHESS_PEXT_AVAILABLE
+	// Compiled for BMI2 regardless of the flags of the rest of the program, only called if the cpu supports it
+	[[nodiscard]] chess::u64 pextIndex(chess::u64 occupied, chess::u64 mask) noexcept;
+#endif
+
+	template <chess::piece slider>
+	[[nodiscard]] constexpr chess::u64 rayAttacks(const chess::u8 squareFrom, const chess::u64 occupied) noexcept {
+		using namespace chess::util;
+		if constexpr (slider == chess::piece::bishop) {
+			return positiveRayAttacks<chess::northWest>(squareFrom, occupied) | positiveRayAttacks<chess::northEast>(squareFrom, occupied) | negativeRayAttacks<chess::southWest>(squareFrom, occupied) | negativeRayAttacks<chess::southEast>(squareFrom, occupied);
+		} else {
+			return positiveRayAttacks<chess::north>(squareFrom, occupied) | positiveRayAttacks<chess::west>(squareFrom, occupied) | negativeRayAttacks<chess::south>(squareFrom, occupied) | negativeRayAttacks<chess::east>(squareFrom, occupied);
+		}
+	}
+
+	template <chess::piece slider>
+	[[nodiscard]] inline chess::u64 attacks(const chess::u8 squareFrom, const chess::u64 occupied) noexcept {
+		static_assert(slider == chess::piece::bishop || slider == chess::piece::rook, "Only bishops and rooks are sliders");
+		const sliderEntry& entry { slider == chess::piece::bishop ? bishopEntries[squareFrom] : rookEntries[squareFrom] };
+		switch (activeBackend) {
+			case backend::magic:
+				return entry.magicAttacks[((occupied & entry.mask) * entry.magic) >> entry.shift];
+#ifdef NMLH_CHESS_PEXT_AVAILABLE
+			case backend::pext:
+#	ifdef __BMI2__
+				return entry.pextAttacks[_pext_u64(occupied, entry.mask)];
+#	else
+				return entry.pextAttacks[pextIndex(occupied, entry.mask)];
+#	endif
+#endif
+			default:
+				return rayAttacks<slider>(squareFrom, occupied);
+		}
+	}
+}    // namespace chess::sliders
+
+#endif    // NMLH_CHESS_SLIDERS_HPP
@@ -21,6 +21,15 @@ namespace chess {
 		northWest = 7
 	};
 
+	// Which moves position::moves generates, so that search can ask for them one stage at a time
+	enum class moveGenType : chess::u8
+	{
+		all,
+		captures,       // Captures, en passant and promotions
+		quiets,         // Everything else, including castling
+		quietChecks     // Quiet moves that give check
+	};
+
 	enum piece : chess::u8
 	{
 		noColor     = 0x0,
@@ -42,6 +42,13 @@ namespace chess::util {
         return static_cast<chess::square>(std::popcount(bitboard));
 	}
 
+	// Hint that the cache line containing address will be read soon
+	inline void prefetch(const void* address) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+		__builtin_prefetch(address);
+#endif
+	}
+
 	// Expand to intergral types
 	inline constexpr u64 zeroLSB(u64& bitboard) noexcept {
 		return bitboard &= bitboard - 1;    // Should become the BLSR instruction on x86
@@ -1,11 +1,19 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 #define AI_MAX_PLY 4
 
 #include "include/ai.hpp"
 
-int main(int argc, const char* argv[]) {
-	const chess::ai::bot nomalahCustomDesignedBot {
+// A UCI engine that stays alive for the whole game, so the transposition table and the game history stay warm between moves
+int main() {
+	chess::ai::bot nomalahCustomDesignedBot {
 		chess::ai::botWeights {
 			.moveOrdering = {
 				.pieceValues         = { 0, 100, 300, 320, 500, 900, 0, 0, 0, 100, 300, 320, 500, 900, 0 },
@@ -21,17 +29,168 @@ int main(int argc, const char* argv[]) {
 			.evaluate = { .pieceValues = { 0, 100, 300, 320, 500, 900, 0, 0, 0, 100, 300, 320, 500, 900, 0 } } }
 	};
 
+	chess::ai::transpositionTable TT { chess::ai::defaultHashMegabytes };
+	size_t threadCount { chess::ai::defaultThreads };
 	// Only supports standard mode
 	chess::game chessGame = chess::defaultGame();
-	for (int moveNumber = 1; moveNumber < argc; moveNumber++) {
-		chessGame.move(std::string { argv[moveNumber] });
-	}
-	std::cerr << chessGame.currentPosition().ascii() << '\n';
-	auto botMove { chess::ai::bestMove(chessGame, nomalahCustomDesignedBot) };
-	chessGame.move(botMove);
-	std::cerr << chessGame.currentPosition().ascii() << '\n';
+	std::string gameStart { "startpos" };    // The fen (or startpos) that chessGame was set up from
+	std::vector<std::string> gameMoves;      // The moves played in chessGame since gameStart
+	chess::ai::searchSignals signals {};
+	std::thread searcher;
+
+	// UCI moves have no promotion marker for non-promotions
+	auto uciMove = [](const chess::moveData move) {
+		const std::string moveString { move.toString() };
+		return moveString.size() > 4 && moveString[4] == '*' ? moveString.substr(0, 4) : moveString;
+	};
+	auto info = [&uciMove](const chess::ai::searchResult& result, const long long time) {
+		std::ostringstream output;
+		output << "info depth " << result.depth << " score ";
+		if (std::abs(result.eval) > chess::ai::mateThreshold) {
+			const int matePlies { chess::ai::mateValue - std::abs(result.eval) };
+			output << "mate " << (result.eval > 0 ? (matePlies + 1) / 2 : -(matePlies + 1) / 2);
+		} else {
+			output << "cp " << result.eval;
+		}
+		output << " nodes " << result.nodes << " time " << time;
+		if (result.move != chess::moveData { 0, 0, 0 })
+			output << " pv " << uciMove(result.move);
+		return output.str();
+	};
+
+	auto stopSearch = [&signals, &searcher]() {
+		signals.stop      = true;
+		signals.pondering = false;
+		signals.pondering.notify_all();
+		if (searcher.joinable())
+			searcher.join();
+	};
 
-	std::string uciMove { botMove.toString() };
-	std::cout << (uciMove[4] == '*' ? uciMove.substr(0, 4) : uciMove);
+	for (std::string line; std::getline(std::cin, line);) {
+		std::istringstream tokens { line };
+		std::string command;
+		tokens >> command;
+
+		if (command == "uci") {
+			std::cout << "id name NomalahChess\n"
+			          << "id author Nomalah\n"
+			          << "option name Hash type spin default " << chess::ai::defaultHashMegabytes << " min 1 max 65536\n"
+			          << "option name Threads type spin default " << chess::ai::defaultThreads << " min 1 max 256\n"
+			          << "option name Ponder type check default false\n"
+			          << "option name EvalFile type string default <empty>\n"
+			          << "uciok" << std::endl;
+		} else if (command == "isready") {
+			std::cout << "readyok" << std::endl;
+		} else if (command == "ucinewgame") {
+			stopSearch();
+			TT.clear();
+		} else if (command == "setoption") {
+			// setoption name <name> value <value>
+			std::string token, name, value;
+			tokens >> token >> name >> token >> value;
+			stopSearch();
+			if (name == "Hash") {
+				TT.resize(std::max<size_t>(std::stoull(value), 1));
+			} else if (name == "Threads") {
+				threadCount = std::max<size_t>(std::stoull(value), 1);
+			} else if (name == "EvalFile") {
+				// Anything that doesn't load falls back to the piece-square evaluation
+				auto network { value.empty() || value == "<empty>" ? nullptr : chess::ai::nnue::load(value) };
+				if (network)
+					std::cout << "info string evaluating with " << value << " (" << chess::ai::nnue::name(chess::ai::nnue::activeBackend) << ")" << std::endl;
+				else
+					std::cout << "info string evaluating with piece-square tables" << std::endl;
+				nomalahCustomDesignedBot.setNetwork(std::move(network));
+			}
+		} else if (command == "position") {
+			// position [startpos | fen <fen>] [moves <moves>...]
+			stopSearch();
+			std::string token, start;
+			tokens >> token;
+			if (token == "fen") {
+				while (tokens >> token && token != "moves") {
+					start += (start.empty() ? "" : " ") + token;
+				}
+			} else {
+				start = "startpos";
+				tokens >> token;
+			}
+			std::vector<std::string> moves;
+			while (token == "moves" && tokens >> token) {
+				moves.push_back(token);
+				token = "moves";
+			}
+
+			// Only the new moves are played when the position continues the current game
+			if (start != gameStart || moves.size() < gameMoves.size() || !std::equal(gameMoves.begin(), gameMoves.end(), moves.begin())) {
+				chessGame = start == "startpos" ? chess::defaultGame() : chess::game { start };
+				gameStart = start;
+				gameMoves.clear();
+			}
+			for (size_t moveIndex { gameMoves.size() }; moveIndex < moves.size(); moveIndex++) {
+				chessGame.move(moves[moveIndex]);
+			}
+			gameMoves = std::move(moves);
+		} else if (command == "go") {
+			// go [ponder] [wtime <ms>] [btime <ms>] [winc <ms>] [binc <ms>] [movestogo <n>] [movetime <ms>] [depth <n>] [infinite]
+			stopSearch();
+			chess::ai::searchLimits limits { .depth = chess::ai::maxSearchDepth };
+			bool ponder { false };
+			for (std::string token; tokens >> token;) {
+				long long value { 0 };
+				if (token == "ponder") {
+					ponder = true;
+					continue;
+				}
+				if (token == "infinite" || !(tokens >> value))
+					continue;
+				if (token == "wtime")
+					limits.whiteTime = value;
+				else if (token == "btime")
+					limits.blackTime = value;
+				else if (token == "winc")
+					limits.whiteIncrement = value;
+				else if (token == "binc")
+					limits.blackIncrement = value;
+				else if (token == "movestogo")
+					limits.movesToGo = static_cast<int>(value);
+				else if (token == "movetime")
+					limits.moveTime = value;
+				else if (token == "depth")
+					limits.depth = std::clamp(static_cast<int>(value), 1, chess::ai::maxSearchDepth);
+			}
+
+			signals.stop      = false;
+			signals.pondering = ponder;
+			searcher          = std::thread([&, limits]() {
+				const auto startTime { std::chrono::steady_clock::now() };
+				const chess::ai::searchResult result { chess::ai::search(chessGame, nomalahCustomDesignedBot, TT, threadCount, limits, signals,
+					                                                         [&info](const chess::ai::searchResult& iteration, const long long time) { std::cout << info(iteration, time) << std::endl; }) };
+				// A bestmove can't be sent while pondering, even if the search ran out of depth
+				signals.pondering.wait(true);
+				const auto duration { std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count() };
+
+				std::ostringstream output;
+				output << info(result, duration);
+				if (result.move == chess::moveData { 0, 0, 0 }) {
+					output << "\nbestmove 0000";
+				} else {
+					output << "\nbestmove " << uciMove(result.move);
+					if (result.ponderMove != chess::moveData { 0, 0, 0 })
+						output << " ponder " << uciMove(result.ponderMove);
+				}
+				std::cout << output.str() << std::endl;
+			});
+		} else if (command == "ponderhit") {
+			// The opponent played the expected move, so the search carries on with the clock running
+			signals.pondering = false;
+			signals.pondering.notify_all();
+		} else if (command == "stop") {
+			stopSearch();
+		} else if (command == "quit") {
+			break;
+		}
+	}
+	stopSearch();
 	return 0;
 }
@@ -1,6 +1,10 @@
+#include <atomic>
 #include <chrono>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -10,9 +14,10 @@ struct timing {
 	size_t totalRuns;
 	std::time_t totalTime;
 };
-timing movesTime = { 0, 0 };
-timing moveTime  = { 0, 0 };
-timing undoTime  = { 0, 0 };
+// Per thread, so the reported timings are sampled from the main thread
+thread_local timing movesTime = { 0, 0 };
+thread_local timing moveTime  = { 0, 0 };
+thread_local timing undoTime  = { 0, 0 };
 
 #define TIME(line, time)                                                                                                                             \
 	auto time##__startTime = std::chrono::high_resolution_clock::now();                                                                              \
@@ -29,49 +34,217 @@ struct perftResult {
 	size_t promotions;
 };
 
-perftResult perft(size_t testDepth, const std::string& fen) {
-	chess::game gameToTest(fen);
-	perftResult result = { 0, {}, 0 };
-	auto perftTest     = [&gameToTest, &result](const auto perftTest, const std::size_t depth) -> std::size_t {
-        if (depth == 0) {
-            return 1;
-        }
-        if (depth == 1) {
-            TIME(auto legalMoves = gameToTest.moves(), movesTime);
-            for (chess::moveData legalMove : legalMoves) {
-                if ((legalMove.flags & 0xFF00) == 0x6000) {
-                    result.enPassant++;
-                } else if ((legalMove.flags & 0xFF00) == 0x7000) {
-                    result.enPassant++;
-                } else if ((legalMove.flags & 0xFF00) == 0x1000) {
-                    result.captures++;
-                } else if ((legalMove.flags & 0xFF00) >= 0x2000 && (legalMove.flags & 0xFF00) <= 0x5000) {
-                    result.castles++;
-                } else if ((legalMove.flags & 0xFF00) >= 0x1100 && (legalMove.flags & 0xFF00) <= 0x1F00) {
-                    result.captures++;
-                    result.promotions++;
-                } else if ((legalMove.flags & 0xFF00) >= 0x0100 && (legalMove.flags & 0xFF00) <= 0x0F00) {
-                    result.promotions++;
-                }
-            }
-            return legalMoves.size();
-        }
-
-        std::size_t nodes = 0;
-        TIME(auto validMoves { gameToTest.moves() }, movesTime);
-        for (auto validMove : validMoves) {
-            TIME(gameToTest.move(validMove), moveTime);
-            nodes += perftTest(perftTest, depth - 1);
-            TIME(gameToTest.undo(), undoTime);
-        }
-        return nodes;
+// Node counts of subtrees keyed by (zobrist hash, depth), shared between threads.
+// Like the transposition table, the key is stored XORed with the data so torn entries fail verification.
+class perftTable {
+	struct tableEntry {
+		std::atomic<chess::u64> keyXorData;
+		std::atomic<chess::u64> data;    // nodes (56) | depth (8)
 	};
+	std::unique_ptr<tableEntry[]> entries;
+	chess::u64 mask;
+
+	[[nodiscard]] static constexpr chess::u64 mix(const chess::u64 key, const std::size_t depth) noexcept { return key ^ (depth * 0x9E3779B97F4A7C15ULL); }
+
+public:
+	perftTable(const std::size_t megabytes) {
+		std::size_t entryCount { 1 };
+		while (entryCount * 2 * sizeof(tableEntry) <= megabytes * 1024 * 1024) {
+			entryCount *= 2;
+		}
+		entries = std::make_unique<tableEntry[]>(entryCount);
+		mask    = entryCount - 1;
+	}
+
+	[[nodiscard]] bool probe(const chess::u64 key, const std::size_t depth, std::size_t& nodes) const noexcept {
+		const tableEntry& entry { entries[mix(key, depth) & mask] };
+		const chess::u64 data { entry.data.load(std::memory_order_relaxed) };
+		if ((entry.keyXorData.load(std::memory_order_relaxed) ^ data) == key && (data & 0xFF) == depth) {
+			nodes = data >> 8;
+			return true;
+		}
+		return false;
+	}
+
+	void store(const chess::u64 key, const std::size_t depth, const std::size_t nodes) noexcept {
+		tableEntry& entry { entries[mix(key, depth) & mask] };
+		const chess::u64 data { (static_cast<chess::u64>(nodes) << 8) | depth };
+		entry.data.store(data, std::memory_order_relaxed);
+		entry.keyXorData.store(key ^ data, std::memory_order_relaxed);
+	}
+};
+
+void countMoveTypes(const chess::moveSlice& legalMoves, perftResult& result) {
+	for (chess::moveData legalMove : legalMoves) {
+		if ((legalMove.flags & 0xFF00) == 0x6000) {
+			result.enPassant++;
+		} else if ((legalMove.flags & 0xFF00) == 0x7000) {
+			result.enPassant++;
+		} else if ((legalMove.flags & 0xFF00) == 0x1000) {
+			result.captures++;
+		} else if ((legalMove.flags & 0xFF00) >= 0x2000 && (legalMove.flags & 0xFF00) <= 0x5000) {
+			result.castles++;
+		} else if ((legalMove.flags & 0xFF00) >= 0x1100 && (legalMove.flags & 0xFF00) <= 0x1F00) {
+			result.captures++;
+			result.promotions++;
+		} else if ((legalMove.flags & 0xFF00) >= 0x0100 && (legalMove.flags & 0xFF00) <= 0x0F00) {
+			result.promotions++;
+		}
+	}
+}
+
+// Pseudo-legal generation leaves each move to be checked when it is played, like the search does
+template <bool pseudoLegal>
+chess::moveSlice generateMoves(chess::moveStack::frame& moveBuffer, const chess::position& toGenerate) {
+	if constexpr (pseudoLegal)
+		return moveBuffer.generatePseudoLegal(toGenerate);
+	else
+		return moveBuffer.generate(toGenerate);
+}
 
+// Only the legal moves, for counting the last ply in bulk
+template <bool pseudoLegal>
+chess::moveSlice generateLegalMoves(chess::moveStack::frame& moveBuffer, const chess::position& toGenerate) {
+	const chess::moveSlice generated { generateMoves<pseudoLegal>(moveBuffer, toGenerate) };
+	if constexpr (!pseudoLegal)
+		return generated;
+	chess::moveSlice legalMoves { generated.begin() };
+	for (const auto pseudoLegalMove : generated) {
+		if (toGenerate.isLegal(pseudoLegalMove))
+			legalMoves.append(pseudoLegalMove);
+	}
+	return legalMoves;
+}
+
+// Move type counts are only collected for subtrees that were not found in the hash table
+// Make/unmake in place through chess::game, generating into a slice of moveBuffers for each ply
+template <bool pseudoLegal>
+std::size_t perftNodes(chess::game& gameToTest, perftResult& result, perftTable* hashTable, chess::moveStack& moveBuffers, const std::size_t depth) {
+	if (depth == 0) {
+		return 1;
+	}
+	chess::moveStack::frame moveBuffer { moveBuffers };
+	if (depth == 1) {
+		TIME(const auto legalMoves { generateLegalMoves<pseudoLegal>(moveBuffer, gameToTest.currentPosition()) }, movesTime);
+		countMoveTypes(legalMoves, result);
+		return legalMoves.size();
+	}
+
+	std::size_t nodes = 0;
+	if (hashTable && hashTable->probe(gameToTest.currentPosition().zobristHash, depth, nodes)) {
+		return nodes;
+	}
+	TIME(const auto validMoves { generateMoves<pseudoLegal>(moveBuffer, gameToTest.currentPosition()) }, movesTime);
+	for (auto validMove : validMoves) {
+		if (pseudoLegal && !gameToTest.currentPosition().isLegal(validMove))
+			continue;
+		TIME(gameToTest.move(validMove), moveTime);
+		nodes += perftNodes<pseudoLegal>(gameToTest, result, hashTable, moveBuffers, depth - 1);
+		TIME(gameToTest.undo(), undoTime);
+	}
+	if (hashTable) {
+		hashTable->store(gameToTest.currentPosition().zobristHash, depth, nodes);
+	}
+	return nodes;
+}
+
+// Copy-make, each child position is a copy of its parent
+template <bool pseudoLegal>
+std::size_t perftNodesCopyMake(const chess::position& positionToTest, perftResult& result, perftTable* hashTable, chess::moveStack& moveBuffers, const std::size_t depth) {
+	if (depth == 0) {
+		return 1;
+	}
+	chess::moveStack::frame moveBuffer { moveBuffers };
+	if (depth == 1) {
+		TIME(const auto legalMoves { generateLegalMoves<pseudoLegal>(moveBuffer, positionToTest) }, movesTime);
+		countMoveTypes(legalMoves, result);
+		return legalMoves.size();
+	}
+
+	std::size_t nodes = 0;
+	if (hashTable && hashTable->probe(positionToTest.zobristHash, depth, nodes)) {
+		return nodes;
+	}
+	TIME(const auto validMoves { generateMoves<pseudoLegal>(moveBuffer, positionToTest) }, movesTime);
+	for (auto validMove : validMoves) {
+		if (pseudoLegal && !positionToTest.isLegal(validMove))
+			continue;
+		TIME(const chess::position childPosition { positionToTest.move(validMove) }, moveTime);
+		nodes += perftNodesCopyMake<pseudoLegal>(childPosition, result, hashTable, moveBuffers, depth - 1);
+	}
+	if (hashTable) {
+		hashTable->store(positionToTest.zobristHash, depth, nodes);
+	}
+	return nodes;
+}
+
+perftResult perft(size_t testDepth, const std::string& fen, const std::size_t threadCount = 1, perftTable* hashTable = nullptr, const bool copyMake = false, const bool pseudoLegal = chess::pseudoLegalGeneration) {
+	chess::game gameToTest(fen);
+	perftResult result {};
+
+	// Split the work at the root, or a ply deeper if there are too few root moves to keep every thread busy
+	struct perftWork {
+		std::size_t rootIndex;
+		std::array<chess::moveData, 2> path;
+		std::size_t pathLength;
+	};
+	std::vector<perftWork> work;
+	const bool splitDeeper { testDepth > 2 && threadCount > 1 && gameToTest.moves().size() < threadCount * 4 };
 	for (auto& validMove : gameToTest.moves()) {
-		gameToTest.move(validMove);
-		result.moves.push_back({ validMove, perftTest(perftTest, testDepth - 1) });
-		gameToTest.undo();
-		result.total += result.moves.back().second;
+		result.moves.push_back({ validMove, 0 });
+		if (splitDeeper) {
+			gameToTest.move(validMove);
+			for (auto& reply : gameToTest.moves()) {
+				work.push_back({ result.moves.size() - 1, { validMove, reply }, 2 });
+			}
+			gameToTest.undo();
+		} else {
+			work.push_back({ result.moves.size() - 1, { validMove }, 1 });
+		}
+	}
+
+	std::vector<std::size_t> workNodes(work.size(), 0);
+	std::atomic<std::size_t> nextWork { 0 };
+	std::mutex resultMutex;
+	auto worker = [&]() {
+		chess::game threadGame { gameToTest };
+		chess::moveStack threadMoveBuffers { testDepth, 1 };
+		perftResult threadResult {};
+		for (std::size_t workIndex; (workIndex = nextWork.fetch_add(1)) < work.size();) {
+			const perftWork& item { work[workIndex] };
+			for (std::size_t pathIndex { 0 }; pathIndex < item.pathLength; pathIndex++) {
+				threadGame.move(item.path[pathIndex]);
+			}
+			const std::size_t depthLeft { testDepth - item.pathLength };
+			if (copyMake)
+				workNodes[workIndex] = pseudoLegal ? perftNodesCopyMake<true>(threadGame.currentPosition(), threadResult, hashTable, threadMoveBuffers, depthLeft)
+				                                   : perftNodesCopyMake<false>(threadGame.currentPosition(), threadResult, hashTable, threadMoveBuffers, depthLeft);
+			else
+				workNodes[workIndex] = pseudoLegal ? perftNodes<true>(threadGame, threadResult, hashTable, threadMoveBuffers, depthLeft)
+				                                   : perftNodes<false>(threadGame, threadResult, hashTable, threadMoveBuffers, depthLeft);
+			for (std::size_t pathIndex { 0 }; pathIndex < item.pathLength; pathIndex++) {
+				threadGame.undo();
+			}
+		}
+		std::lock_guard<std::mutex> lock { resultMutex };
+		result.captures += threadResult.captures;
+		result.enPassant += threadResult.enPassant;
+		result.castles += threadResult.castles;
+		result.promotions += threadResult.promotions;
+	};
+
+	std::vector<std::thread> helpers;
+	for (std::size_t threadIndex { 1 }; threadIndex < threadCount; threadIndex++) {
+		helpers.emplace_back(worker);
+	}
+	worker();
+	for (auto& helper : helpers) {
+		helper.join();
+	}
+
+	for (std::size_t workIndex { 0 }; workIndex < work.size(); workIndex++) {
+		result.moves[work[workIndex].rootIndex].second += workNodes[workIndex];
+		result.total += workNodes[workIndex];
 	}
 	return result;
 }
@@ -119,19 +292,58 @@ int main(int argc, const char* argv[]) {
 		  { "8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1", { { 1, 37 }, { 2, 183 }, { 3, 6559 }, { 4, 23527 }, { 5, 811573 }, { 6, 3114998 }, { 7, 104644508 } } } }
 	};
 
-	if (argc == 3) {
-		std::string fen              = argv[1];
+	// Usage: perft [--threads N] [--hash MB] [--copy-make] [--sliders rays|magic|pext] [--fills scalar|avx2] [--generator legal|pseudo|compare] [fen depth]
+	std::vector<std::string> arguments;
+	std::size_t threadCount { std::max<std::size_t>(std::thread::hardware_concurrency(), 1) };
+	std::size_t hashMegabytes { 0 };
+	bool copyMake { false };
+	// Whether each run generates pseudo-legal moves, comparing runs every test with both
+	std::vector<bool> generators { chess::pseudoLegalGeneration };
+	auto generatorName = [](const bool pseudoLegal) { return pseudoLegal ? "pseudo-legal" : "legal"; };
+	for (int argumentIndex { 1 }; argumentIndex < argc; argumentIndex++) {
+		const std::string argument { argv[argumentIndex] };
+		if (argument == "--threads" && argumentIndex + 1 < argc) {
+			threadCount = std::max<std::size_t>(std::stoull(argv[++argumentIndex]), 1);
+		} else if (argument == "--hash" && argumentIndex + 1 < argc) {
+			hashMegabytes = std::stoull(argv[++argumentIndex]);
+		} else if (argument == "--copy-make") {
+			copyMake = true;
+		} else if (argument == "--fills" && argumentIndex + 1 < argc) {
+			const std::string backendName { argv[++argumentIndex] };
+			if (!chess::sliders::select(backendName == "avx2" ? chess::sliders::fillBackend::avx2 : chess::sliders::fillBackend::scalar))
+				std::cout << "\u001b[31m[Fills]:[" << backendName << "] is not supported by this cpu, using [" << chess::sliders::name(chess::sliders::activeFillBackend) << "]\u001b[0m" << std::endl;
+		} else if (argument == "--generator" && argumentIndex + 1 < argc) {
+			const std::string requestedGenerator { argv[++argumentIndex] };
+			generators = requestedGenerator == "compare" ? std::vector<bool> { false, true } : std::vector<bool> { requestedGenerator == "pseudo" };
+		} else if (argument == "--sliders" && argumentIndex + 1 < argc) {
+			const std::string backendName { argv[++argumentIndex] };
+			const chess::sliders::backend requestedBackend { backendName == "rays" ? chess::sliders::backend::rays : backendName == "pext" ? chess::sliders::backend::pext : chess::sliders::backend::magic };
+			if (!chess::sliders::select(requestedBackend))
+				std::cout << "\u001b[31m[Sliders]:[" << backendName << "] is not supported by this cpu, using [" << chess::sliders::name(chess::sliders::activeBackend) << "]\u001b[0m" << std::endl;
+		} else {
+			arguments.push_back(argument);
+		}
+	}
+	std::unique_ptr<perftTable> hashTable { hashMegabytes ? std::make_unique<perftTable>(hashMegabytes) : nullptr };
+	std::cout << "\u001b[34m[Threads]:[" << threadCount << "] [Hash]:[" << hashMegabytes << "MB] [Make]:[" << (copyMake ? "copy-make" : "make/unmake") << "] [Sliders]:[" << chess::sliders::name(chess::sliders::activeBackend) << "] [Fills]:[" << chess::sliders::name(chess::sliders::activeFillBackend) << "] [Generator]:[" << (generators.size() > 1 ? "compare" : generatorName(generators.front())) << "]\u001b[0m" << std::endl;
+
+	if (arguments.size() == 2) {
+		std::string fen              = arguments[0];
 		chess::position testPosition = chess::position::fromFen(fen);
 		std::cout << "\u001b[34m[Test]@Position=" << fen << std::endl;
 		std::cout << "\u001b[33m" << testPosition.ascii() << "\u001b[34m" << std::endl;
-		auto startTime         = std::chrono::high_resolution_clock::now();
-		perftResult testResult = perft(std::stoull(argv[2]), fen);
-		auto endTime           = std::chrono::high_resolution_clock::now();
-		auto duration          = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
-		for (auto& [move, total] : testResult.moves) {
-			std::cout << "\t[" << move.toString() << "]:[" << total << "]\n";
+		for (const bool pseudoLegal : generators) {
+			auto startTime         = std::chrono::high_resolution_clock::now();
+			perftResult testResult = perft(std::stoull(arguments[1]), fen, threadCount, hashTable.get(), copyMake, pseudoLegal);
+			auto endTime           = std::chrono::high_resolution_clock::now();
+			auto duration          = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
+			if (pseudoLegal == generators.front()) {
+				for (auto& [move, total] : testResult.moves) {
+					std::cout << "\t[" << move.toString() << "]:[" << total << "]\n";
+				}
+			}
+			std::cout << "[Generator]:[" << generatorName(pseudoLegal) << "] [Total Nodes Visited]:[" << testResult.total << "] [Test Duration]:[" << duration << "ms]\u001b[0m\n";
 		}
-		std::cout << "[Total Nodes Visited]:[" << testResult.total << "] [Test Duration]:[" << duration << "ms]\u001b[0m\n";
 		return 0;
 	}
 
@@ -153,30 +365,40 @@ int main(int argc, const char* argv[]) {
 			std::cout << "\t[Fen]\u001b[31m[Failed Test]\u001b[0m -> [Result]:[" << testFenResult << "] - [Known Result]:[" << test.testFen << "]" << std::endl;
 		}
 
+		std::vector<long long> generatorDurations(generators.size(), 0);
 		for (const perftTestResult& knownTestResult : test.testList) {
-			auto startTime         = std::chrono::high_resolution_clock::now();
-			perftResult testResult = perft(knownTestResult.depth, test.testFen);
-			auto endTime           = std::chrono::high_resolution_clock::now();
-			auto duration          = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count();
-			if (testResult.total != knownTestResult.nodes) {
-				std::cout << "\t\u001b[31m[Failed Test]@Depth=" << knownTestResult.depth << "\u001b[0m -> [Perft Result]:[" << testResult.total << "] - [Known Result]:[" << knownTestResult.nodes << "] - \u001b[34m[kn/s]:[" << testResult.total * 1000 / duration << "]" << std::endl;
-				std::cout << "\t\t\u001b[33m[Captures]:[" << testResult.captures << "]\n";
-				std::cout << "\t\t[En Passant]:[" << testResult.enPassant << "]\n";
-				std::cout << "\t\t[Castles]:[" << testResult.castles << "]\n";
-				std::cout << "\t\t[Promotions]:[" << testResult.promotions << "]\n\u001b[34m";
-				for (auto& [move, total] : testResult.moves) {
-					std::cout << "\t\t[" << move.toString() << "]:[" << total << "]\n";
+			for (std::size_t generatorIndex { 0 }; generatorIndex < generators.size(); generatorIndex++) {
+				auto startTime         = std::chrono::high_resolution_clock::now();
+				perftResult testResult = perft(knownTestResult.depth, test.testFen, threadCount, hashTable.get(), copyMake, generators[generatorIndex]);
+				auto endTime           = std::chrono::high_resolution_clock::now();
+				auto duration          = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count();
+				generatorDurations[generatorIndex] += duration;
+				const std::string generatorLabel { generators.size() > 1 ? std::string { " [Generator]:[" } + generatorName(generators[generatorIndex]) + "]" : "" };
+				if (testResult.total != knownTestResult.nodes) {
+					std::cout << "\t\u001b[31m[Failed Test]@Depth=" << knownTestResult.depth << "\u001b[0m -> [Perft Result]:[" << testResult.total << "] - [Known Result]:[" << knownTestResult.nodes << "] - \u001b[34m[kn/s]:[" << testResult.total * 1000 / duration << "]" << generatorLabel << std::endl;
+					std::cout << "\t\t\u001b[33m[Captures]:[" << testResult.captures << "]\n";
+					std::cout << "\t\t[En Passant]:[" << testResult.enPassant << "]\n";
+					std::cout << "\t\t[Castles]:[" << testResult.castles << "]\n";
+					std::cout << "\t\t[Promotions]:[" << testResult.promotions << "]\n\u001b[34m";
+					for (auto& [move, total] : testResult.moves) {
+						std::cout << "\t\t[" << move.toString() << "]:[" << total << "]\n";
+					}
+				} else {
+					std::cout << "\t\u001b[32m[Passed Test]@Depth=" << knownTestResult.depth << "\u001b[0m -> [Perft Result]:[" << testResult.total << "] - \u001b[34m[kn/s]:[" << testResult.total * 1000 / duration << "]" << generatorLabel << std::endl;
+					perftPassedTests++;
 				}
-			} else {
-				std::cout << "\t\u001b[32m[Passed Test]@Depth=" << knownTestResult.depth << "\u001b[0m -> [Perft Result]:[" << testResult.total << "] - \u001b[34m[kn/s]:[" << testResult.total * 1000 / duration << "]" << std::endl;
-				perftPassedTests++;
+				perftTotalTests++;
 			}
-			perftTotalTests++;
+		}
+		if (generators.size() > 1) {
+			const bool pseudoLegalFaster { generatorDurations[1] < generatorDurations[0] };
+			std::cout << "\t\u001b[34m[Faster]:[" << generatorName(pseudoLegalFaster) << "] [legal]:[" << generatorDurations[0] / 1000 << "ms] [pseudo-legal]:[" << generatorDurations[1] / 1000 << "ms]\u001b[0m" << std::endl;
 		}
 	}
 	std::cout << "\u001b[34m[Perft:Passed/Total]:[" << perftPassedTests << "/" << perftTotalTests << "]\u001b[0m\n";
 	std::cout << "\u001b[34m[Fen:Passed/Total]:[" << fenPassedTests << "/" << fenTotalTests << "]\u001b[0m\n";
 	std::cout << "\u001b[34m[.moves()]:[" << (movesTime.totalTime / movesTime.totalRuns) << "ns/iter]:[" << movesTime.totalRuns << "iters]\u001b[0m\n";
 	std::cout << "\u001b[34m[.move()]:[" << (moveTime.totalTime / moveTime.totalRuns) << "ns/iter]:[" << moveTime.totalRuns << "iters]\u001b[0m\n";
-	std::cout << "\u001b[34m[.undo()]:[" << (undoTime.totalTime / undoTime.totalRuns) << "ns/iter]:[" << undoTime.totalRuns << "iters]\u001b[0m\n";
+	if (undoTime.totalRuns)    // Copy-make never undoes
+		std::cout << "\u001b[34m[.undo()]:[" << (undoTime.totalTime / undoTime.totalRuns) << "ns/iter]:[" << undoTime.totalRuns << "iters]\u001b[0m\n";
 }
\ No newline at end of file
@@ -3,11 +3,38 @@
 #include "chess.hpp"
 
 [[nodiscard]] chess::moveList chess::game::moves() const noexcept {
-	// Continue with normal move generation
-	if (this->currentPosition().turn() == white) {
-		return this->currentPosition().moves<white>();
-	} else {
-		return this->currentPosition().moves<black>();
+	return this->currentPosition().moves();
+}
+
+[[nodiscard]] chess::moveList chess::position::moves(const chess::moveGenType genType) const noexcept {
+	chess::moveList result;
+	result.assign(this->moves(result.begin(), genType));
+	return result;
+}
+
+[[nodiscard]] chess::moveSlice chess::position::moves(chess::moveData* out, const chess::moveGenType genType) const noexcept {
+	switch (genType) {
+		case chess::moveGenType::captures:
+			return this->turn() == white ? this->moves<white, chess::moveGenType::captures>(out) : this->moves<black, chess::moveGenType::captures>(out);
+		case chess::moveGenType::quiets:
+			return this->turn() == white ? this->moves<white, chess::moveGenType::quiets>(out) : this->moves<black, chess::moveGenType::quiets>(out);
+		case chess::moveGenType::quietChecks:
+			return this->turn() == white ? this->moves<white, chess::moveGenType::quietChecks>(out) : this->moves<black, chess::moveGenType::quietChecks>(out);
+		default:
+			return this->turn() == white ? this->moves<white>(out) : this->moves<black>(out);
+	}
+}
+
+[[nodiscard]] chess::moveSlice chess::position::pseudoLegalMoves(chess::moveData* out, const chess::moveGenType genType) const noexcept {
+	switch (genType) {
+		case chess::moveGenType::captures:
+			return this->turn() == white ? this->pseudoLegalMoves<white, chess::moveGenType::captures>(out) : this->pseudoLegalMoves<black, chess::moveGenType::captures>(out);
+		case chess::moveGenType::quiets:
+			return this->turn() == white ? this->pseudoLegalMoves<white, chess::moveGenType::quiets>(out) : this->pseudoLegalMoves<black, chess::moveGenType::quiets>(out);
+		case chess::moveGenType::quietChecks:
+			return this->turn() == white ? this->pseudoLegalMoves<white, chess::moveGenType::quietChecks>(out) : this->pseudoLegalMoves<black, chess::moveGenType::quietChecks>(out);
+		default:
+			return this->turn() == white ? this->pseudoLegalMoves<white>(out) : this->pseudoLegalMoves<black>(out);
 	}
 }
 
@@ -17,11 +44,13 @@ template <chess::piece allyColor>
 		return chess::moveList {};
 	}
 	// Continue with normal move generation
-	return this->currentPosition().moves<allyColor>();
+	chess::moveList result;
+	result.assign(this->currentPosition().moves<allyColor>(result.begin()));
+	return result;
 }
 
 template <chess::piece piece>
-void chess::position::generatePieceMoves(chess::moveList& legalMoves, const chess::u64 pinnedPieces, const chess::u64 notAlly, const chess::u64 mask) const noexcept {
+void chess::position::generatePieceMoves(chess::moveSlice& legalMoves, const chess::u64 pinnedPieces, const chess::u64 notAlly, const chess::u64 mask) const noexcept {
 	chess::u64 allyPieces { this->bitboards[piece] & ~pinnedPieces };    // Pieces that are not pinned
 	while (allyPieces) {
 		const chess::u8 currentAllyPieceIndex { chess::util::ctz64(allyPieces) };
@@ -38,8 +67,8 @@ void chess::position::generatePieceMoves(chess::moveList& legalMoves, const ches
 	}
 };
 
-template <chess::piece allyColor>
-[[nodiscard]] chess::moveList chess::position::moves() const noexcept {
+template <chess::piece allyColor, chess::moveGenType genType>
+[[nodiscard]] chess::moveSlice chess::position::moves(chess::moveData* out) const noexcept {
 	using namespace chess;
 	using namespace chess::util;
 	using namespace chess::constants;
@@ -58,8 +87,13 @@ template <chess::piece allyColor>
 	constexpr piece opponentQueen { constructPiece(queen, opponentColor) };
 	constexpr piece opponentKing { constructPiece(king, opponentColor) };
 
+	constexpr bool generateCaptures { genType == moveGenType::all || genType == moveGenType::captures };
+	constexpr bool generateQuiets { genType != moveGenType::captures };
+
 	const u64 notAlly { ~this->bitboards[allyColor] };
-	moveList legalMoves;    // chess::move = 4 bytes * 254 + 8 byte pointer = 1KB
+	// Squares that the generated moves may land on (pawns are filtered separately, as their pushes and captures differ)
+	const u64 targets { genType == moveGenType::captures ? this->bitboards[opponentColor] : genType == moveGenType::all ? notAlly : this->empty() };
+	moveSlice legalMoves { out };
 
 	const chess::square allyKingLocation { ctz64(this->bitboards[allyKing]) };
 
@@ -77,7 +111,7 @@ template <chess::piece allyColor>
 			const auto ray = attackFunction(allyKingLocation, this->bitboards[opponentColor]);
 			if (ray & (this->bitboards[opponentRook] | this->bitboards[opponentQueen]) && popcnt64(ray & this->bitboards[allyColor]) == 1) {    // If there is one ally piece inbetween, it's pinned
 				pinnedPieces |= ray & this->bitboards[allyColor];
-				auto movementMask { ray & notAlly };
+				auto movementMask { ray & targets };
 				auto blockerLocation { ctz64(ray & this->bitboards[allyColor]) };
 				if (ray & (this->bitboards[allyRook] | this->bitboards[allyQueen])) {
 					while (movementMask) {
@@ -88,7 +122,7 @@ template <chess::piece allyColor>
 						                    .destinationIndex = moveSpot });
 						zeroLSB(movementMask);
 					}
-				} else if (ray & this->bitboards[allyPawn]) {
+				} else if (generateQuiets && ray & this->bitboards[allyPawn]) {
 					chess::u64 singlePush = allyColor == white ? ((1ULL << blockerLocation) << 8) & this->empty() : ((1ULL << blockerLocation) >> 8) & this->empty();
 					chess::u64 doublePush = allyColor == white ? (singlePush << 8) & this->empty() & 0xFF000000ULL : (singlePush >> 8) & this->empty() & 0xFF00000000ULL;
 					if (singlePush) {    // not double pawn push
@@ -111,7 +145,7 @@ template <chess::piece allyColor>
 			const auto ray = attackFunction(allyKingLocation, this->bitboards[opponentColor]);
 			if (ray & (this->bitboards[opponentRook] | this->bitboards[opponentQueen]) && popcnt64(ray & this->bitboards[allyColor]) == 1) {    // If there is one ally piece inbetween, it's pinned
 				pinnedPieces |= ray & this->bitboards[allyColor];
-				auto movementMask { ray & notAlly };
+				auto movementMask { ray & targets };
 				auto blockerLocation { ctz64(ray & this->bitboards[allyColor]) };
 				if (this->pieceAtIndex[blockerLocation] == allyRook || this->pieceAtIndex[blockerLocation] == allyQueen) {
 					while (movementMask) {
@@ -129,7 +163,7 @@ template <chess::piece allyColor>
 			const auto ray = attackFunction(allyKingLocation, this->bitboards[opponentColor]);
 			if (ray & (this->bitboards[opponentBishop] | this->bitboards[opponentQueen]) && popcnt64(ray & this->bitboards[allyColor]) == 1) {    // If there is one ally piece inbetween, it's pinned
 				pinnedPieces |= ray & this->bitboards[allyColor];
-				auto movementMask { ray & notAlly };
+				auto movementMask { ray & targets };
 				auto blockerLocation { ctz64(ray & this->bitboards[allyColor]) };
 				if (this->pieceAtIndex[blockerLocation] == allyBishop || this->pieceAtIndex[blockerLocation] == allyQueen) {
 					while (movementMask) {
@@ -140,8 +174,8 @@ template <chess::piece allyColor>
 						                    .destinationIndex = moveSpot });
 						zeroLSB(movementMask);
 					}
-				} else if (this->pieceAtIndex[blockerLocation] == allyPawn) {
-					const chess::u64 capture = pawnAttacks[allyColor >> 3][blockerLocation] & (this->bitboards[opponentColor] | this->enPassantTargetBitboard) & movementMask;
+				} else if (generateCaptures && this->pieceAtIndex[blockerLocation] == allyPawn) {
+					const chess::u64 capture = pawnAttacks[allyColor >> 3][blockerLocation] & (this->bitboards[opponentColor] | this->enPassantTargetBitboard) & ray & notAlly;
 					// Only one capture is allowed when pinned
 					if (capture & this->enPassantTargetBitboard) {
 						// enPassant is possible if pinned
@@ -169,12 +203,14 @@ template <chess::piece allyColor>
 		calculateDiagonalPin(rayAttack<southWest>);
 		calculateDiagonalPin(rayAttack<southEast>);
 
-		generatePieceMoves<allyKnight>(legalMoves, pinnedPieces, notAlly);
-		generatePieceMoves<allyRook>(legalMoves, pinnedPieces, notAlly);
-		generatePieceMoves<allyBishop>(legalMoves, pinnedPieces, notAlly);
-		generatePieceMoves<allyQueen>(legalMoves, pinnedPieces, notAlly);
+		generatePieceMoves<allyKnight>(legalMoves, pinnedPieces, targets);
+		generatePieceMoves<allyRook>(legalMoves, pinnedPieces, targets);
+		generatePieceMoves<allyBishop>(legalMoves, pinnedPieces, targets);
+		generatePieceMoves<allyQueen>(legalMoves, pinnedPieces, targets);
 
-		if constexpr (allyColor == white) {
+		if constexpr (!generateQuiets) {
+			// Castling is a quiet move
+		} else if constexpr (allyColor == white) {
 			if (this->castleWK()) {
 				if (!(this->bitboards[occupied] & (bitboardFromIndex(g1) | bitboardFromIndex(f1))) && (notAttackedByOpponent & bitboardFromIndex(f1)) && (notAttackedByOpponent & bitboardFromIndex(g1))) {
 					legalMoves.append({ .flags            = static_cast<u16>(0x2000 | (whiteKing << 4)),
@@ -217,7 +253,7 @@ template <chess::piece allyColor>
 			const auto promotionPush { singlePush & (allyColor == white ? 0xFF00000000000000 : 0xFF) };
 			auto promotionCapture { capture & (allyColor == white ? 0xFF00000000000000 : 0xFF) };
 
-			if (promotionCapture) {
+			if (generateCaptures && promotionCapture) {
 				while (promotionCapture) {    // not double pawn push
 					const u8 moveSpot { static_cast<u8>(ctz64(promotionCapture)) };
 					legalMoves.append({ .flags            = static_cast<u16>(0x1000 | (allyKnight << 8) | (allyPawn << 4) | this->pieceAtIndex[moveSpot]),
@@ -234,7 +270,7 @@ template <chess::piece allyColor>
 					                    .destinationIndex = moveSpot });
 					zeroLSB(promotionCapture);
 				}
-			} else if (notEnPassantCapture) {
+			} else if (generateCaptures && notEnPassantCapture) {
 				while (notEnPassantCapture) {    // not double pawn push
 					const u8 moveSpot { static_cast<u8>(ctz64(notEnPassantCapture)) };
 					auto destinationPiece { this->pieceAtIndex[moveSpot] };
@@ -245,7 +281,7 @@ template <chess::piece allyColor>
 				}
 			}
 
-			if (enPassant) [[unlikely]] {
+			if (generateCaptures && enPassant) [[unlikely]] {
 				const u8 moveSpot { static_cast<u8>(ctz64(enPassant)) };
 				auto newPos { this->move({ .flags            = static_cast<u16>((allyColor ? 0x6000 : 0x7000) | allyPawn << 4),
 					                       .originIndex      = currentAllyPawnIndex,
@@ -257,7 +293,7 @@ template <chess::piece allyColor>
 				}
 			}
 
-			if (promotionPush) [[unlikely]] {
+			if (generateCaptures && promotionPush) [[unlikely]] {
 				const u8 moveSpot { static_cast<u8>(ctz64(promotionPush)) };
 				legalMoves.append({ .flags            = static_cast<u16>((allyKnight << 8) | (allyPawn << 4) | this->pieceAtIndex[moveSpot]),
 				                    .originIndex      = currentAllyPawnIndex,
@@ -271,7 +307,7 @@ template <chess::piece allyColor>
 				legalMoves.append({ .flags            = static_cast<u16>((allyQueen << 8) | (allyPawn << 4) | this->pieceAtIndex[moveSpot]),
 				                    .originIndex      = currentAllyPawnIndex,
 				                    .destinationIndex = moveSpot });
-			} else if (singlePush) {
+			} else if (generateQuiets && singlePush && !promotionPush) {
 				const u8 moveSpot { static_cast<u8>(ctz64(singlePush)) };
 				legalMoves.append({ .flags            = static_cast<u16>(allyPawn << 4),
 				                    .originIndex      = currentAllyPawnIndex,
@@ -315,10 +351,10 @@ template <chess::piece allyColor>
 		markPinned(rayAttack<northEast>, opponentBishop);
 		markPinned(rayAttack<southEast>, opponentBishop);
 
-		generatePieceMoves<allyKnight>(legalMoves, pinnedPieces, notAlly, (captureMask | blockMask));
-		generatePieceMoves<allyRook>(legalMoves, pinnedPieces, notAlly, (captureMask | blockMask));
-		generatePieceMoves<allyBishop>(legalMoves, pinnedPieces, notAlly, (captureMask | blockMask));
-		generatePieceMoves<allyQueen>(legalMoves, pinnedPieces, notAlly, (captureMask | blockMask));
+		generatePieceMoves<allyKnight>(legalMoves, pinnedPieces, targets, (captureMask | blockMask));
+		generatePieceMoves<allyRook>(legalMoves, pinnedPieces, targets, (captureMask | blockMask));
+		generatePieceMoves<allyBishop>(legalMoves, pinnedPieces, targets, (captureMask | blockMask));
+		generatePieceMoves<allyQueen>(legalMoves, pinnedPieces, targets, (captureMask | blockMask));
 
 		u64 allyPawns { this->bitboards[allyPawn] & ~pinnedPieces };
 		const u64 enPassantTargetSquare_local { checkers & this->bitboards[opponentPawn] ? this->enPassantTargetBitboard : 0 };    // En passant is only available if the checking piece is a pawn
@@ -334,7 +370,7 @@ template <chess::piece allyColor>
 			const auto promotionPush { singlePush & (allyColor == white ? 0xFF00000000000000 : 0xFF) };
 			const auto promotionCapture { capture & (allyColor == white ? 0xFF00000000000000 : 0xFF) };
 
-			if (promotionCapture) {
+			if (generateCaptures && promotionCapture) {
 				const u8 moveSpot { static_cast<u8>(ctz64(promotionCapture)) };
 				legalMoves.append({ .flags            = static_cast<u16>(0x1000 | (allyKnight << 8) | (allyPawn << 4) | this->pieceAtIndex[moveSpot]),
 				                    .originIndex      = currentAllyPawnIndex,
@@ -348,12 +384,12 @@ template <chess::piece allyColor>
 				legalMoves.append({ .flags            = static_cast<u16>(0x1000 | (allyQueen << 8) | (allyPawn << 4) | this->pieceAtIndex[moveSpot]),
 				                    .originIndex      = currentAllyPawnIndex,
 				                    .destinationIndex = moveSpot });
-			} else if (capture) {
+			} else if (generateCaptures && capture) {
 				const u8 moveSpot { static_cast<u8>(ctz64(capture)) };
 				legalMoves.append({ .flags            = static_cast<u16>(0x1000 | (allyPawn << 4) | this->pieceAtIndex[moveSpot]),
 				                    .originIndex      = currentAllyPawnIndex,
 				                    .destinationIndex = moveSpot });
-			} else if (enPassant) [[unlikely]] {
+			} else if (generateCaptures && enPassant) [[unlikely]] {
 				const u8 moveSpot { static_cast<u8>(ctz64(enPassant)) };
 				auto newPos { this->move({ .flags            = static_cast<u16>((allyColor ? 0x6000 : 0x7000) | allyPawn << 4),
 					                       .originIndex      = currentAllyPawnIndex,
@@ -365,7 +401,7 @@ template <chess::piece allyColor>
 				}
 			}
 
-			if (promotionPush) [[unlikely]] {
+			if (generateCaptures && promotionPush) [[unlikely]] {
 				const u8 moveSpot { static_cast<u8>(ctz64(promotionPush)) };
 				legalMoves.append({ .flags            = static_cast<u16>((allyKnight << 8) | (allyPawn << 4) | this->pieceAtIndex[moveSpot]),
 				                    .originIndex      = currentAllyPawnIndex,
@@ -379,14 +415,14 @@ template <chess::piece allyColor>
 				legalMoves.append({ .flags            = static_cast<u16>((allyQueen << 8) | (allyPawn << 4) | this->pieceAtIndex[moveSpot]),
 				                    .originIndex      = currentAllyPawnIndex,
 				                    .destinationIndex = moveSpot });
-			} else if (singlePush) {
+			} else if (generateQuiets && singlePush && !promotionPush) {
 				const u8 moveSpot { static_cast<u8>(ctz64(singlePush)) };
 				legalMoves.append({ .flags            = static_cast<u16>(allyPawn << 4),
 				                    .originIndex      = currentAllyPawnIndex,
 				                    .destinationIndex = moveSpot });
 			}
 
-			if (doublePush) {    // double pawn push (only one possible per pawn)
+			if (generateQuiets && doublePush) {    // double pawn push (only one possible per pawn)
 				const u8 moveSpot { static_cast<u8>(ctz64(doublePush)) };
 				legalMoves.append({ .flags            = static_cast<u16>((allyColor ? 0x8000 : 0x9000) | (allyPawn << 4)),
 				                    .originIndex      = currentAllyPawnIndex,
@@ -396,7 +432,7 @@ template <chess::piece allyColor>
 		}
 	}
 	// King can always move.
-	u64 allyKingMoves { this->pieceMoves<king>(allyKingLocation, this->bitboards[occupied]) & notAlly & notAttackedByOpponent };
+	u64 allyKingMoves { this->pieceMoves<king>(allyKingLocation, this->bitboards[occupied]) & targets & notAttackedByOpponent };
 	while (allyKingMoves) {
 		const auto destinationSquare { ctz64(allyKingMoves) };
 		const auto destinationPiece { this->pieceAtIndex[destinationSquare] };
@@ -406,9 +442,341 @@ template <chess::piece allyColor>
 		zeroLSB(allyKingMoves);
 	}
 
+	if constexpr (genType == moveGenType::quietChecks) {
+		// Kept in place, ahead of the moves already looked at
+		moveSlice checkingMoves { out };
+		for (const auto legalMove : legalMoves) {
+			if (this->givesCheck(legalMove))
+				checkingMoves.append(legalMove);
+		}
+		return checkingMoves;
+	}
 	return legalMoves;
 }
 
+// Moves that follow how each piece moves but may leave the king in check, for isLegal to sort out once one is about to be played.
+// Nothing is spent on checkers or pins, only castling looks at the squares the opponent attacks.
+template <chess::piece allyColor, chess::moveGenType genType>
+[[nodiscard]] chess::moveSlice chess::position::pseudoLegalMoves(chess::moveData* out) const noexcept {
+	using namespace chess;
+	using namespace chess::util;
+	using namespace chess::constants;
+	constexpr piece allyPawn { constructPiece(pawn, allyColor) };
+	constexpr piece allyKnight { constructPiece(knight, allyColor) };
+	constexpr piece allyBishop { constructPiece(bishop, allyColor) };
+	constexpr piece allyRook { constructPiece(rook, allyColor) };
+	constexpr piece allyQueen { constructPiece(queen, allyColor) };
+	constexpr piece allyKing { constructPiece(king, allyColor) };
+	constexpr piece opponentColor { ~allyColor };
+
+	constexpr bool generateCaptures { genType == moveGenType::all || genType == moveGenType::captures };
+	constexpr bool generateQuiets { genType != moveGenType::captures };
+
+	const u64 targets { genType == moveGenType::captures ? this->bitboards[opponentColor] : genType == moveGenType::all ? ~this->bitboards[allyColor] : this->empty() };
+	moveSlice pseudoLegalMoves { out };
+
+	generatePieceMoves<allyKnight>(pseudoLegalMoves, 0, targets);
+	generatePieceMoves<allyRook>(pseudoLegalMoves, 0, targets);
+	generatePieceMoves<allyBishop>(pseudoLegalMoves, 0, targets);
+	generatePieceMoves<allyQueen>(pseudoLegalMoves, 0, targets);
+	generatePieceMoves<allyKing>(pseudoLegalMoves, 0, targets);
+
+	// Pawns move together, each destination is offset squares ahead of the pawn that moves there
+	constexpr int forward { allyColor == white ? 8 : -8 };
+	constexpr int captureLeft { allyColor == white ? 9 : -9 };
+	constexpr int captureRight { allyColor == white ? 7 : -7 };
+	constexpr u64 promotionRank { allyColor == white ? 0xFF00000000000000ULL : 0xFFULL };
+	constexpr u64 doublePushRank { allyColor == white ? 0xFF000000ULL : 0xFF00000000ULL };
+	const auto appendPawnMoves = [&pseudoLegalMoves, this](u64 destinations, const int offset, const u16 moveType, const bool promotion) {
+		for (; destinations; zeroLSB(destinations)) {
+			const u8 destinationSquare { ctz64(destinations) };
+			const u8 originSquare { static_cast<u8>(destinationSquare - offset) };
+			const u16 targetPiece { static_cast<u16>(moveType == 0x1000 || promotion ? this->pieceAtIndex[destinationSquare] : 0) };
+			if (!promotion) {
+				pseudoLegalMoves.append({ .flags = static_cast<u16>(moveType | (allyPawn << 4) | targetPiece), .originIndex = originSquare, .destinationIndex = destinationSquare });
+				continue;
+			}
+			for (const piece promotionPiece : { allyKnight, allyBishop, allyRook, allyQueen }) {
+				pseudoLegalMoves.append({ .flags = static_cast<u16>(moveType | (promotionPiece << 8) | (allyPawn << 4) | targetPiece), .originIndex = originSquare, .destinationIndex = destinationSquare });
+			}
+		}
+	};
+	const u64 allyPawns { this->bitboards[allyPawn] };
+	const u64 singlePushes { (allyColor == white ? allyPawns << 8 : allyPawns >> 8) & this->empty() };
+	if constexpr (generateCaptures) {
+		const u64 leftCaptures { allyColor == white ? (allyPawns << 9) & ~0x0101010101010101ULL : (allyPawns >> 9) & ~0x8080808080808080ULL };
+		const u64 rightCaptures { allyColor == white ? (allyPawns << 7) & ~0x8080808080808080ULL : (allyPawns >> 7) & ~0x0101010101010101ULL };
+		const u64 opponentPieces { this->bitboards[opponentColor] };
+		appendPawnMoves(leftCaptures & opponentPieces & ~promotionRank, captureLeft, 0x1000, false);
+		appendPawnMoves(rightCaptures & opponentPieces & ~promotionRank, captureRight, 0x1000, false);
+		appendPawnMoves(leftCaptures & opponentPieces & promotionRank, captureLeft, 0x1000, true);
+		appendPawnMoves(rightCaptures & opponentPieces & promotionRank, captureRight, 0x1000, true);
+		appendPawnMoves(singlePushes & promotionRank, forward, 0, true);
+		appendPawnMoves(leftCaptures & this->enPassantTargetBitboard, captureLeft, allyColor ? 0x6000 : 0x7000, false);
+		appendPawnMoves(rightCaptures & this->enPassantTargetBitboard, captureRight, allyColor ? 0x6000 : 0x7000, false);
+	}
+	if constexpr (generateQuiets) {
+		const u64 doublePushes { (allyColor == white ? singlePushes << 8 : singlePushes >> 8) & this->empty() & doublePushRank };
+		appendPawnMoves(singlePushes & ~promotionRank, forward, 0, false);
+		appendPawnMoves(doublePushes, 2 * forward, allyColor ? 0x8000 : 0x9000, false);
+
+		// The king can't castle out of, through or into check
+		constexpr piece opponentKing { constructPiece(king, opponentColor) };
+		const auto attacked = [this](const chess::square target) { return this->attackers<opponentColor>(target) || (kingAttacks[target] & this->bitboards[opponentKing]); };
+		if constexpr (allyColor == white) {
+			if (this->castleWK() && !(this->bitboards[occupied] & (bitboardFromIndex(g1) | bitboardFromIndex(f1))) && !attacked(e1) && !attacked(f1) && !attacked(g1)) {
+				pseudoLegalMoves.append({ .flags = static_cast<u16>(0x2000 | (whiteKing << 4)), .originIndex = e1, .destinationIndex = g1 });
+			}
+			if (this->castleWQ() && !(this->bitboards[occupied] & (bitboardFromIndex(d1) | bitboardFromIndex(c1) | bitboardFromIndex(b1))) && !attacked(e1) && !attacked(d1) && !attacked(c1)) {
+				pseudoLegalMoves.append({ .flags = static_cast<u16>(0x3000 | (whiteKing << 4)), .originIndex = e1, .destinationIndex = c1 });
+			}
+		} else {
+			if (this->castleBK() && !(this->bitboards[occupied] & (bitboardFromIndex(g8) | bitboardFromIndex(f8))) && !attacked(e8) && !attacked(f8) && !attacked(g8)) {
+				pseudoLegalMoves.append({ .flags = static_cast<u16>(0x4000 | (blackKing << 4)), .originIndex = e8, .destinationIndex = g8 });
+			}
+			if (this->castleBQ() && !(this->bitboards[occupied] & (bitboardFromIndex(d8) | bitboardFromIndex(c8) | bitboardFromIndex(b8))) && !attacked(e8) && !attacked(d8) && !attacked(c8)) {
+				pseudoLegalMoves.append({ .flags = static_cast<u16>(0x5000 | (blackKing << 4)), .originIndex = e8, .destinationIndex = c8 });
+			}
+		}
+	}
+
+	if constexpr (genType == moveGenType::quietChecks) {
+		moveSlice checkingMoves { out };
+		for (const auto pseudoLegalMove : pseudoLegalMoves) {
+			if (this->givesCheck(pseudoLegalMove))
+				checkingMoves.append(pseudoLegalMove);
+		}
+		return checkingMoves;
+	}
+	return pseudoLegalMoves;
+}
+
+// Whether a pseudo-legal move of the side to move leaves its king out of check, from the opponent's pieces that are left once it is made
+[[nodiscard]] bool chess::position::isLegal(const chess::moveData pseudoLegalMove) const noexcept {
+	using namespace chess::util;
+	using namespace chess::constants;
+	const chess::u16 moveType { static_cast<chess::u16>(pseudoLegalMove.flags & 0xF000) };
+	if (moveType >= 0x2000 && moveType <= 0x5000) {
+		return true;    // Castling was checked in full when it was generated
+	}
+	const chess::piece allyColor { this->turn() };
+	const chess::piece opponentColor { ~allyColor };
+	const chess::u64 destinationSquare { pseudoLegalMove.destinationSquare() };
+	const chess::u64 capturedSquare { moveType == 0x6000 ? destinationSquare >> 8 : moveType == 0x7000 ? destinationSquare << 8 : destinationSquare };
+	const chess::u64 occupiedSquares { (this->bitboards[occupied] & ~pseudoLegalMove.originSquare() & ~capturedSquare) | destinationSquare };
+	const chess::square allyKingLocation { getPieceOf(pseudoLegalMove.movePiece()) == king ? static_cast<chess::square>(pseudoLegalMove.destinationIndex) : ctz64(this->bitboards[constructPiece(king, allyColor)]) };
+	const chess::u64 opponentPieces { this->bitboards[opponentColor] & ~capturedSquare };
+
+	return !((this->pieceMoves<bishop>(allyKingLocation, occupiedSquares) & (this->bitboards[constructPiece(bishop, opponentColor)] | this->bitboards[constructPiece(queen, opponentColor)]) & opponentPieces) ||
+	         (this->pieceMoves<rook>(allyKingLocation, occupiedSquares) & (this->bitboards[constructPiece(rook, opponentColor)] | this->bitboards[constructPiece(queen, opponentColor)]) & opponentPieces) ||
+	         (knightJumps[allyKingLocation] & this->bitboards[constructPiece(knight, opponentColor)] & opponentPieces) ||
+	         (pawnAttacks[allyColor >> 3][allyKingLocation] & this->bitboards[constructPiece(pawn, opponentColor)] & opponentPieces) ||
+	         (kingAttacks[allyKingLocation] & this->bitboards[constructPiece(king, opponentColor)]));
+}
+
+// The pseudo-legal move of the side to move from origin to destination, promoting to promotionType (or 0), or a null move if there is none.
+// Restores the flags of a move that was stored as only its squares, so it can be played without generating the moves of the position.
+[[nodiscard]] chess::moveData chess::position::pseudoLegalMove(const chess::square origin, const chess::square destination, const chess::piece promotionType) const noexcept {
+	using namespace chess::util;
+	using namespace chess::constants;
+	constexpr chess::moveData noMove { 0, 0, 0 };
+	const chess::piece allyColor { this->turn() };
+	const chess::piece movingPiece { this->pieceAtIndex[origin] };
+	const chess::piece targetPiece { this->pieceAtIndex[destination] };
+	if (origin == destination || movingPiece == chess::piece::empty || colorOf(movingPiece) != allyColor || (targetPiece != chess::piece::empty && colorOf(targetPiece) == allyColor))
+		return noMove;
+	const chess::u64 destinationSquare { bitboardFromIndex(destination) };
+	const chess::u16 pieceFlags { static_cast<chess::u16>(movingPiece << 4) };
+
+	if (getPieceOf(movingPiece) == pawn) {
+		const bool promotion { static_cast<bool>(destinationSquare & (allyColor == white ? 0xFF00000000000000ULL : 0xFFULL)) };
+		if (promotion != (promotionType >= knight && promotionType <= queen))
+			return noMove;
+		const chess::u16 promotionFlags { static_cast<chess::u16>(promotion ? constructPiece(promotionType, allyColor) << 8 : 0) };
+		const int forward { allyColor == white ? 8 : -8 };
+		if (pawnAttacks[allyColor >> 3][origin] & destinationSquare) {
+			if (targetPiece != chess::piece::empty)
+				return { static_cast<chess::u16>(0x1000 | promotionFlags | pieceFlags | targetPiece), origin, destination };
+			if (destinationSquare & this->enPassantTargetBitboard)
+				return { static_cast<chess::u16>((allyColor ? 0x6000 : 0x7000) | pieceFlags), origin, destination };
+			return noMove;
+		}
+		if (targetPiece != chess::piece::empty)
+			return noMove;
+		if (destination == origin + forward)
+			return { static_cast<chess::u16>(promotionFlags | pieceFlags | (promotion ? targetPiece : 0)), origin, destination };
+		if (destination == origin + 2 * forward && (destinationSquare & (allyColor == white ? 0xFF000000ULL : 0xFF00000000ULL)) && this->pieceAtIndex[origin + forward] == chess::piece::empty)
+			return { static_cast<chess::u16>((allyColor ? 0x8000 : 0x9000) | pieceFlags), origin, destination };
+		return noMove;
+	}
+	if (promotionType != 0)
+		return noMove;
+
+	chess::u64 reachable { 0 };
+	switch (getPieceOf(movingPiece)) {
+		case knight:
+			reachable = this->pieceMoves<knight>(origin, this->bitboards[occupied]);
+			break;
+		case bishop:
+			reachable = this->pieceMoves<bishop>(origin, this->bitboards[occupied]);
+			break;
+		case rook:
+			reachable = this->pieceMoves<rook>(origin, this->bitboards[occupied]);
+			break;
+		case queen:
+			reachable = this->pieceMoves<queen>(origin, this->bitboards[occupied]);
+			break;
+		case king: {
+			reachable = this->pieceMoves<king>(origin, this->bitboards[occupied]);
+			if (reachable & destinationSquare)
+				break;
+			// Castling, with the same checks as the generators
+			const auto attacked = [this, allyColor](const chess::square target) {
+				return allyColor == white ? (this->attackers<black>(target) || (kingAttacks[target] & this->bitboards[blackKing])) : (this->attackers<white>(target) || (kingAttacks[target] & this->bitboards[whiteKing]));
+			};
+			const auto castles = [&](const bool right, const chess::square kingSquare, const chess::square kingTarget, const chess::square passedSquare, const chess::u64 between, const chess::u16 moveType) {
+				return origin == kingSquare && destination == kingTarget && right && !(this->bitboards[occupied] & between) && !attacked(kingSquare) && !attacked(passedSquare) && !attacked(kingTarget)
+				           ? chess::moveData { static_cast<chess::u16>(moveType | pieceFlags), origin, destination }
+				           : noMove;
+			};
+			if (allyColor == white)
+				return destination == g1 ? castles(this->castleWK(), e1, g1, f1, bitboardFromIndex(f1) | bitboardFromIndex(g1), 0x2000)
+				                         : castles(this->castleWQ(), e1, c1, d1, bitboardFromIndex(d1) | bitboardFromIndex(c1) | bitboardFromIndex(b1), 0x3000);
+			return destination == g8 ? castles(this->castleBK(), e8, g8, f8, bitboardFromIndex(f8) | bitboardFromIndex(g8), 0x4000)
+			                         : castles(this->castleBQ(), e8, c8, d8, bitboardFromIndex(d8) | bitboardFromIndex(c8) | bitboardFromIndex(b8), 0x5000);
+		}
+		default:
+			return noMove;
+	}
+	if (!(reachable & destinationSquare))
+		return noMove;
+	return { static_cast<chess::u16>(getCaptureFlag(targetPiece) | pieceFlags | targetPiece), origin, destination };
+}
+
+// Whether a legal move of the side to move checks the opponent, direct or discovered, without making it
+[[nodiscard]] bool chess::position::givesCheck(const chess::moveData legalMove) const noexcept {
+	using namespace chess::util;
+	using namespace chess::constants;
+	const chess::piece allyColor { this->turn() };
+	const chess::piece opponentColor { ~allyColor };
+	const chess::square opponentKingLocation { ctz64(this->bitboards[constructPiece(king, opponentColor)]) };
+	const chess::u64 originSquare { legalMove.originSquare() };
+	const chess::u64 destinationSquare { legalMove.destinationSquare() };
+
+	// Ally pieces and occupancy once the move has been made
+	chess::u64 occupiedSquares { (this->bitboards[occupied] & ~originSquare) | destinationSquare };
+	chess::u64 pawns { this->bitboards[constructPiece(pawn, allyColor)] & ~originSquare };
+	chess::u64 knights { this->bitboards[constructPiece(knight, allyColor)] & ~originSquare };
+	chess::u64 diagonalSliders { (this->bitboards[constructPiece(bishop, allyColor)] | this->bitboards[constructPiece(queen, allyColor)]) & ~originSquare };
+	chess::u64 orthogonalSliders { (this->bitboards[constructPiece(rook, allyColor)] | this->bitboards[constructPiece(queen, allyColor)]) & ~originSquare };
+
+	switch (getPieceOf(legalMove.promotionPiece() ? legalMove.promotionPiece() : legalMove.movePiece())) {
+		case pawn:
+			pawns |= destinationSquare;
+			break;
+		case knight:
+			knights |= destinationSquare;
+			break;
+		case bishop:
+			diagonalSliders |= destinationSquare;
+			break;
+		case rook:
+			orthogonalSliders |= destinationSquare;
+			break;
+		case queen:
+			diagonalSliders |= destinationSquare;
+			orthogonalSliders |= destinationSquare;
+			break;
+		default:
+			break;
+	}
+
+	switch (legalMove.flags & 0xF000) {
+		case 0x2000:    // White kingside
+			occupiedSquares ^= bitboardFromIndex(h1) | bitboardFromIndex(f1);
+			orthogonalSliders ^= bitboardFromIndex(h1) | bitboardFromIndex(f1);
+			break;
+		case 0x3000:    // White queenside
+			occupiedSquares ^= bitboardFromIndex(a1) | bitboardFromIndex(d1);
+			orthogonalSliders ^= bitboardFromIndex(a1) | bitboardFromIndex(d1);
+			break;
+		case 0x4000:    // Black kingside
+			occupiedSquares ^= bitboardFromIndex(h8) | bitboardFromIndex(f8);
+			orthogonalSliders ^= bitboardFromIndex(h8) | bitboardFromIndex(f8);
+			break;
+		case 0x5000:    // Black queenside
+			occupiedSquares ^= bitboardFromIndex(a8) | bitboardFromIndex(d8);
+			orthogonalSliders ^= bitboardFromIndex(a8) | bitboardFromIndex(d8);
+			break;
+		case 0x6000:    // White en passant, the captured pawn is behind the destination
+			occupiedSquares &= ~(destinationSquare >> 8);
+			break;
+		case 0x7000:    // Black en passant
+			occupiedSquares &= ~(destinationSquare << 8);
+			break;
+		default:
+			break;
+	}
+
+	return (this->pieceMoves<knight>(opponentKingLocation, occupiedSquares) & knights) ||
+	       (pawnAttacks[opponentColor >> 3][opponentKingLocation] & pawns) ||
+	       (this->pieceMoves<bishop>(opponentKingLocation, occupiedSquares) & diagonalSliders) ||
+	       (this->pieceMoves<rook>(opponentKingLocation, occupiedSquares) & orthogonalSliders);
+}
+
+// Both sides take back on the destination with their least valuable attacker, and either side may stop when taking would lose material.
+// Each piece that takes is removed from the occupancy, so sliders lined up behind it join in (x-rays). Promotions on recaptures are ignored.
+[[nodiscard]] int chess::position::staticExchange(const chess::moveData legalMove, const int (&pieceValues)[16]) const noexcept {
+	using namespace chess::util;
+	const chess::square targetSquare { static_cast<chess::square>(legalMove.destinationIndex) };
+	const chess::u16 moveType { static_cast<chess::u16>(legalMove.flags & 0xF000) };
+	const chess::u64 diagonalSliders { this->bitboards[whiteBishop] | this->bitboards[blackBishop] | this->bitboards[whiteQueen] | this->bitboards[blackQueen] };
+	const chess::u64 orthogonalSliders { this->bitboards[whiteRook] | this->bitboards[blackRook] | this->bitboards[whiteQueen] | this->bitboards[blackQueen] };
+	chess::u64 occupiedSquares { this->bitboards[occupied] ^ legalMove.originSquare() };
+
+	// gain[n] is the material won once n recaptures have been made, if the side to move then stops
+	std::array<int, 32> gain {};
+	int pieceOnTarget { pieceValues[legalMove.movePiece()] };
+	if (moveType == 0x6000 || moveType == 0x7000) {
+		gain[0] = pieceValues[pawn];
+		occupiedSquares ^= moveType == 0x6000 ? legalMove.destinationSquare() >> 8 : legalMove.destinationSquare() << 8;
+	} else {
+		gain[0] = pieceValues[this->pieceAtIndex[targetSquare]];
+	}
+	if (legalMove.promotionPiece()) {
+		gain[0] += pieceValues[legalMove.promotionPiece()] - pieceOnTarget;
+		pieceOnTarget = pieceValues[legalMove.promotionPiece()];
+	}
+
+	chess::u64 attackersLeft { this->attackersTo(targetSquare, occupiedSquares) & occupiedSquares };
+	chess::piece sideToCapture { ~this->turn() };
+	size_t captures { 0 };
+	while (const chess::u64 sideAttackers { attackersLeft & this->bitboards[sideToCapture] }) {
+		chess::piece attacker { pawn };
+		chess::u64 attackerSquares { 0 };
+		for (; attacker <= king; attacker = static_cast<chess::piece>(attacker + 1)) {
+			attackerSquares = sideAttackers & this->bitboards[constructPiece(attacker, sideToCapture)];
+			if (attackerSquares)
+				break;
+		}
+		// The king can only take a piece nothing else defends
+		if (attacker == king && (attackersLeft & this->bitboards[~sideToCapture]))
+			break;
+		captures++;
+		gain[captures] = pieceOnTarget - gain[captures - 1];
+		pieceOnTarget  = pieceValues[constructPiece(attacker, sideToCapture)];
+		occupiedSquares ^= attackerSquares & (~attackerSquares + 1);
+		attackersLeft |= (this->pieceMoves<bishop>(targetSquare, occupiedSquares) & diagonalSliders) | (this->pieceMoves<rook>(targetSquare, occupiedSquares) & orthogonalSliders);
+		attackersLeft &= occupiedSquares;
+		sideToCapture = ~sideToCapture;
+	}
+	// Each side only makes its capture if that is better than stopping
+	for (; captures > 0; captures--) {
+		gain[captures - 1] = -std::max(-gain[captures - 1], gain[captures]);
+	}
+	return gain[0];
+}
+
 template <chess::piece attackingColor>
 [[nodiscard]] chess::u64 chess::position::attacks() const noexcept {
 	using namespace chess::util;
@@ -419,28 +787,30 @@ template <chess::piece attackingColor>
 	constexpr chess::piece attackingQueen { constructPiece(queen, attackingColor) };
 	constexpr chess::piece attackingKing { constructPiece(king, attackingColor) };
 
-	chess::u64 resultAttackBoard { 0 };
-
 	// 'occupied squares'
 	const chess::u64 occupiedSquares { this->bitboards[occupied] ^ this->bitboards[piece::whiteKing ^ attackingColor] };    // remove the king
 
-	// Find bishop attacks
-	for (chess::u64 remainingBishops { this->bitboards[attackingBishop] | this->bitboards[attackingQueen] }; remainingBishops; zeroLSB(remainingBishops)) {
-		const chess::u8 squareFrom { ctz64(remainingBishops) };
-		resultAttackBoard |= this->pieceMoves<bishop>(squareFrom, occupiedSquares);
-	}
-
-	// Find rook attacks
-	for (chess::u64 remainingRooks { this->bitboards[attackingRook] | this->bitboards[attackingQueen] }; remainingRooks; zeroLSB(remainingRooks)) {
-		const chess::u8 squareFrom { ctz64(remainingRooks) };
-		resultAttackBoard |= this->pieceMoves<rook>(squareFrom, occupiedSquares);
+	const chess::u64 orthogonalSliders { this->bitboards[attackingRook] | this->bitboards[attackingQueen] };
+	const chess::u64 diagonalSliders { this->bitboards[attackingBishop] | this->bitboards[attackingQueen] };
+	chess::u64 resultAttackBoard { 0 };
+	if (chess::sliders::activeFillBackend == chess::sliders::fillBackend::avx2) {
+		// Every slider at once
+		resultAttackBoard = chess::sliders::setwiseAttacks(orthogonalSliders, diagonalSliders, occupiedSquares);
+	} else {
+		// Filling one direction at a time is slower than looking up each slider
+		for (chess::u64 remainingBishops { diagonalSliders }; remainingBishops; zeroLSB(remainingBishops)) {
+			resultAttackBoard |= this->pieceMoves<bishop>(ctz64(remainingBishops), occupiedSquares);
+		}
+		for (chess::u64 remainingRooks { orthogonalSliders }; remainingRooks; zeroLSB(remainingRooks)) {
+			resultAttackBoard |= this->pieceMoves<rook>(ctz64(remainingRooks), occupiedSquares);
+		}
 	}
 
-	// Find knight attacks
-	for (chess::u64 remainingKnights { this->bitboards[attackingKnight] }; remainingKnights; zeroLSB(remainingKnights)) {
-		const chess::u8 squareFrom { ctz64(remainingKnights) };
-		resultAttackBoard |= this->pieceMoves<knight>(squareFrom, occupiedSquares);
-	}
+	// Every knight at once, one file across and two ranks up or down, or two files across and one rank
+	const chess::u64 knights { this->bitboards[attackingKnight] };
+	const chess::u64 oneFile { ((knights << 1) & ~0x0101010101010101ULL) | ((knights >> 1) & ~0x8080808080808080ULL) };
+	const chess::u64 twoFiles { ((knights << 2) & ~0x0303030303030303ULL) | ((knights >> 2) & ~0xC0C0C0C0C0C0C0C0ULL) };
+	resultAttackBoard |= (oneFile << 16) | (oneFile >> 16) | (twoFiles << 8) | (twoFiles >> 8);
 
 	resultAttackBoard |= constants::kingAttacks[ctz64(this->bitboards[attackingKing])];
 
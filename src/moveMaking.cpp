@@ -6,12 +6,43 @@
 #include "chess.hpp"
 
 void chess::game::move(const chess::moveData desiredMove) noexcept {
-	gameHistory.push_back(gameHistory.back().move(desiredMove));
+	repetitionKeys.push_back(current.zobristHash);
+	gameHistory.push_back({ desiredMove, current.makeMove(desiredMove) });
 }
 
 [[nodiscard]] chess::position chess::position::move(chess::moveData desiredMove) const noexcept {
+	chess::position result = *this;
+	result.makeMove(desiredMove);
+	return result;
+}
+
+chess::undoRecord chess::position::makeMove(chess::moveData desiredMove) noexcept {
 	using namespace chess::constants;
-	chess::position result         = *this;
+	const chess::undoRecord undo { .enPassantTargetBitboard = this->enPassantTargetBitboard,
+		                           .zobristHash             = this->zobristHash,
+		                           .pawnHash                = this->pawnHash,
+		                           .evaluation              = this->evaluation,
+		                           .fullMoveClock           = this->fullMoveClock,
+		                           .flags                   = this->flags,
+		                           .halfMoveClock           = this->halfMoveClock };
+
+	// Remove the old state, and the old piece keys and scores of changed squares
+	const auto removeSquare = [this](const chess::u8 changedSquare) {
+		this->zobristHash ^= zobristBitStrings[changedSquare][this->pieceAtIndex[changedSquare]];
+		if (chess::util::getPieceOf(this->pieceAtIndex[changedSquare]) == chess::piece::pawn)
+			this->pawnHash ^= zobristBitStrings[changedSquare][this->pieceAtIndex[changedSquare]];
+		this->evaluation -= (*this->scoreTable)[this->pieceAtIndex[changedSquare]][changedSquare];
+	};
+	const auto addSquare = [this](const chess::u8 changedSquare) {
+		this->zobristHash ^= zobristBitStrings[changedSquare][this->pieceAtIndex[changedSquare]];
+		if (chess::util::getPieceOf(this->pieceAtIndex[changedSquare]) == chess::piece::pawn)
+			this->pawnHash ^= zobristBitStrings[changedSquare][this->pieceAtIndex[changedSquare]];
+		this->evaluation += (*this->scoreTable)[this->pieceAtIndex[changedSquare]][changedSquare];
+	};
+	this->zobristHash ^= this->zobristState();
+	forEachChangedSquare(desiredMove, removeSquare);
+
+	chess::position& result        = *this;
 	result.enPassantTargetBitboard = 0x0;
 	result.halfMoveClock++;
 	if (this->turn() == chess::piece::black)
@@ -136,8 +167,110 @@ void chess::game::move(const chess::moveData desiredMove) noexcept {
 
 	result.bitboards[piece::occupied] = result.bitboards[white] | result.bitboards[black];
 	result.bitboards[piece::empty]    = ~result.bitboards[piece::occupied];
-	result.setZobrist();
-	return result;
+
+	// Add the new state, and the new piece keys and scores of changed squares
+	forEachChangedSquare(desiredMove, addSquare);
+	result.zobristHash ^= result.zobristState();
+#ifdef CHESS_DEBUG
+	assert(result.zobristHash == result.computeZobrist());
+	assert(result.pawnHash == result.computePawnHash());
+	assert(result.evaluation == result.computeEvaluation());
+#endif
+	return undo;
+}
+
+void chess::position::unmakeMove(const chess::moveData desiredMove, const chess::undoRecord& undo) noexcept {
+	using namespace chess::constants;
+	const auto togglePiece = [this](const chess::piece targetPiece, const chess::u64 squares) {
+		this->bitboards[chess::util::colorOf(targetPiece)] ^= squares;    // Colour only
+		this->bitboards[targetPiece] ^= squares;                          // Colour and Piece
+	};
+	const auto moveFlags { desiredMove.moveFlags() };
+	if (moveFlags == 0x0000 || moveFlags == 0x8000 || moveFlags == 0x9000) {    // Quiet or double pawn push
+		togglePiece(desiredMove.movePiece(), desiredMove.originSquare() | desiredMove.destinationSquare());
+		this->pieceAtIndex[desiredMove.destinationIndex] = piece::empty;
+	} else if (moveFlags == 0x1000) {    // Capture
+		togglePiece(desiredMove.movePiece(), desiredMove.originSquare() | desiredMove.destinationSquare());
+		togglePiece(desiredMove.capturedPiece(), desiredMove.destinationSquare());
+		this->pieceAtIndex[desiredMove.destinationIndex] = desiredMove.capturedPiece();
+	} else if (moveFlags >= 0x0100 && moveFlags <= 0x1F00) {    // Promotion, with or without a capture
+		togglePiece(desiredMove.promotionPiece(), desiredMove.destinationSquare());
+		togglePiece(desiredMove.movePiece(), desiredMove.originSquare());
+		if (moveFlags >= 0x1100) {
+			togglePiece(desiredMove.capturedPiece(), desiredMove.destinationSquare());
+			this->pieceAtIndex[desiredMove.destinationIndex] = desiredMove.capturedPiece();
+		} else {
+			this->pieceAtIndex[desiredMove.destinationIndex] = piece::empty;
+		}
+	} else if (moveFlags >= 0x2000 && moveFlags <= 0x5000) {    // Castling
+		struct castleSquares {
+			chess::square rookOrigin;
+			chess::square rookDestination;
+			chess::piece rook;
+		};
+		constexpr std::array<castleSquares, 4> castles { { { h1, f1, whiteRook }, { a1, d1, whiteRook }, { h8, f8, blackRook }, { a8, d8, blackRook } } };
+		const auto& castle { castles[(moveFlags >> 12) - 2] };
+		togglePiece(desiredMove.movePiece(), desiredMove.originSquare() | desiredMove.destinationSquare());
+		togglePiece(castle.rook, chess::util::bitboardFromIndex(castle.rookOrigin) | chess::util::bitboardFromIndex(castle.rookDestination));
+		this->pieceAtIndex[desiredMove.destinationIndex] = piece::empty;
+		this->pieceAtIndex[castle.rookDestination]       = piece::empty;
+		this->pieceAtIndex[castle.rookOrigin]            = castle.rook;
+	} else if (moveFlags == 0x6000 || moveFlags == 0x7000) {    // En passant
+		const chess::u8 capturedIndex = moveFlags == 0x6000 ? desiredMove.destinationIndex - 8 : desiredMove.destinationIndex + 8;
+		const chess::piece capturedPawn { moveFlags == 0x6000 ? blackPawn : whitePawn };
+		togglePiece(desiredMove.movePiece(), desiredMove.originSquare() | desiredMove.destinationSquare());
+		togglePiece(capturedPawn, chess::util::bitboardFromIndex(capturedIndex));
+		this->pieceAtIndex[desiredMove.destinationIndex] = piece::empty;
+		this->pieceAtIndex[capturedIndex]                = capturedPawn;
+	} else {
+		std::cerr << "Unknown Move: " << std::hex << desiredMove.moveFlags() << '\n';
+		assert(false);
+	}
+	this->pieceAtIndex[desiredMove.originIndex] = desiredMove.movePiece();
+
+	this->bitboards[piece::occupied] = this->bitboards[white] | this->bitboards[black];
+	this->bitboards[piece::empty]    = ~this->bitboards[piece::occupied];
+	this->enPassantTargetBitboard    = undo.enPassantTargetBitboard;
+	this->zobristHash                = undo.zobristHash;
+	this->pawnHash                   = undo.pawnHash;
+	this->evaluation                 = undo.evaluation;
+	this->fullMoveClock              = undo.fullMoveClock;
+	this->flags                      = undo.flags;
+	this->halfMoveClock              = undo.halfMoveClock;
+#ifdef CHESS_DEBUG
+	assert(this->zobristHash == this->computeZobrist());
+#endif
+}
+
+chess::undoRecord chess::position::makeNullMove() noexcept {
+	const chess::undoRecord undo { .enPassantTargetBitboard = this->enPassantTargetBitboard,
+		                           .zobristHash             = this->zobristHash,
+		                           .pawnHash                = this->pawnHash,
+		                           .evaluation              = this->evaluation,
+		                           .fullMoveClock           = this->fullMoveClock,
+		                           .flags                   = this->flags,
+		                           .halfMoveClock           = this->halfMoveClock };
+	// Only the state changes, no piece keys
+	this->zobristHash ^= this->zobristState();
+	this->enPassantTargetBitboard = 0x0;
+	this->halfMoveClock++;
+	if (this->turn() == chess::piece::black)
+		this->fullMoveClock++;
+	this->flags ^= chess::piece::white;
+	this->zobristHash ^= this->zobristState();
+#ifdef CHESS_DEBUG
+	assert(this->zobristHash == this->computeZobrist());
+#endif
+	return undo;
+}
+
+void chess::position::unmakeNullMove(const chess::undoRecord& undo) noexcept {
+	this->enPassantTargetBitboard = undo.enPassantTargetBitboard;
+	this->zobristHash             = undo.zobristHash;
+	this->evaluation              = undo.evaluation;
+	this->fullMoveClock           = undo.fullMoveClock;
+	this->flags                   = undo.flags;
+	this->halfMoveClock           = undo.halfMoveClock;
 }
 
 void chess::game::move(const std::string& uciMove) noexcept {
@@ -215,9 +348,22 @@ void chess::game::move(const std::string& uciMove) noexcept {
 	this->move(libraryMove);
 }
 
+void chess::game::nullMove() noexcept {
+	nullMoveHeights.push_back(gameHistory.size());
+	repetitionKeys.push_back(current.zobristHash);
+	gameHistory.push_back({ { 0, 0, 0 }, current.makeNullMove() });
+}
+
 bool chess::game::undo() noexcept {
-	if (gameHistory.size() > 1) {
+	if (!gameHistory.empty()) {
+		if (gameHistory.back().move == chess::moveData { 0, 0, 0 }) {
+			current.unmakeNullMove(gameHistory.back().undo);
+			nullMoveHeights.pop_back();
+		} else {
+			current.unmakeMove(gameHistory.back().move, gameHistory.back().undo);
+		}
 		gameHistory.pop_back();
+		repetitionKeys.pop_back();
 		return true;
 	} else {
 		return false;
@@ -0,0 +1,263 @@
+#include <array>
+
+#include "chess.hpp"
+
+std::array<chess::sliders::sliderEntry, 64> chess::sliders::bishopEntries {};
+std::array<chess::sliders::sliderEntry, 64> chess::sliders::rookEntries {};
+chess::sliders::backend chess::sliders::activeBackend { chess::sliders::backend::rays };
+chess::sliders::fillBackend chess::sliders::activeFillBackend { chess::sliders::fillBackend::scalar };
+
+namespace {
+	// Sum over every square of 2 ^ (bits in the relevant occupancy)
+	std::array<chess::u64, 5248> bishopMagicTable;
+	std::array<chess::u64, 5248> bishopPextTable;
+	std::array<chess::u64, 102400> rookMagicTable;
+	std::array<chess::u64, 102400> rookPextTable;
+
+	// xorshift64*, reseeded for every square so that every run finds the same magics
+	// The seeds per rank are ones known to find magics in few attempts
+	constexpr std::array<chess::u64, 8> magicSeeds { 728, 10316, 55013, 32803, 12281, 15100, 16645, 255 };
+	chess::u64 randomState { magicSeeds[0] };
+	chess::u64 random() noexcept {
+		randomState ^= randomState >> 12;
+		randomState ^= randomState << 25;
+		randomState ^= randomState >> 27;
+		return randomState * 2685821657736338717ULL;
+	}
+
+	template <chess::piece slider>
+	constexpr chess::u64 relevantOccupancy(const chess::u8 squareFrom) noexcept {
+		using namespace chess::constants;
+		constexpr chess::u64 rank1 { 0x00000000000000FFULL };
+		constexpr chess::u64 rank8 { 0xFF00000000000000ULL };
+		constexpr chess::u64 fileH { 0x0101010101010101ULL };
+		constexpr chess::u64 fileA { 0x8080808080808080ULL };
+		if constexpr (slider == chess::piece::bishop) {
+			return (attackRays[chess::northEast][squareFrom] | attackRays[chess::northWest][squareFrom] | attackRays[chess::southEast][squareFrom] | attackRays[chess::southWest][squareFrom]) & ~(rank1 | rank8 | fileH | fileA);
+		} else {
+			return ((attackRays[chess::north][squareFrom] | attackRays[chess::south][squareFrom]) & ~(rank1 | rank8)) |
+			       ((attackRays[chess::east][squareFrom] | attackRays[chess::west][squareFrom]) & ~(fileH | fileA));
+		}
+	}
+
+	template <chess::piece slider, std::size_t tableSize>
+	void initialiseSlider(std::array<chess::sliders::sliderEntry, 64>& entries, std::array<chess::u64, tableSize>& magicTable, std::array<chess::u64, tableSize>& pextTable) {
+		std::array<chess::u64, 4096> occupancies;
+		std::array<chess::u64, 4096> referenceAttacks;
+		std::array<int, 4096> attemptOfIndex {};
+		int attempt { 0 };
+		std::size_t offset { 0 };
+		for (chess::u8 squareFrom { 0 }; squareFrom < 64; squareFrom++) {
+			auto& entry { entries[squareFrom] };
+			entry.mask         = relevantOccupancy<slider>(squareFrom);
+			entry.shift        = static_cast<chess::u8>(64 - chess::util::popcnt64(entry.mask));
+			entry.magicAttacks = magicTable.data() + offset;
+			entry.pextAttacks  = pextTable.data() + offset;
+
+			// Enumerate every subset of the mask (Carry-Rippler), which is also the order of their pext indices
+			std::size_t subsetCount { 0 };
+			chess::u64 subset { 0 };
+			do {
+				occupancies[subsetCount]      = subset;
+				referenceAttacks[subsetCount] = chess::sliders::rayAttacks<slider>(squareFrom, subset);
+				pextTable[offset + subsetCount] = referenceAttacks[subsetCount];
+				subsetCount++;
+				subset = (subset - entry.mask) & entry.mask;
+			} while (subset);
+
+			// Try sparse random numbers until one maps every subset without a destructive collision
+			randomState = magicSeeds[squareFrom / 8];
+			for (bool found { false }; !found;) {
+				entry.magic = random() & random() & random();
+				if (chess::util::popcnt64((entry.mask * entry.magic) >> 56) < 6)
+					continue;
+				attempt++;
+				found = true;
+				for (std::size_t subsetIndex { 0 }; subsetIndex < subsetCount; subsetIndex++) {
+					const std::size_t index { static_cast<std::size_t>((occupancies[subsetIndex] * entry.magic) >> entry.shift) };
+					if (attemptOfIndex[index] < attempt) {
+						attemptOfIndex[index]       = attempt;
+						magicTable[offset + index] = referenceAttacks[subsetIndex];
+					} else if (magicTable[offset + index] != referenceAttacks[subsetIndex]) {
+						found = false;
+						break;
+					}
+				}
+			}
+			offset += subsetCount;
+		}
+	}
+
+	const bool slidersInitialised = []() {
+		initialiseSlider<chess::piece::bishop>(chess::sliders::bishopEntries, bishopMagicTable, bishopPextTable);
+		initialiseSlider<chess::piece::rook>(chess::sliders::rookEntries, rookMagicTable, rookPextTable);
+		chess::sliders::select(chess::sliders::bestBackend());
+		chess::sliders::select(chess::sliders::avx2Supported() ? chess::sliders::fillBackend::avx2 : chess::sliders::fillBackend::scalar);
+		return true;
+	}();
+
+	constexpr chess::u64 notFileH { ~0x0101010101010101ULL };
+	constexpr chess::u64 notFileA { ~0x8080808080808080ULL };
+
+	// A step in a direction shifts left (positive) or right by its shift, and can only land on its mask without wrapping around the board
+	struct fillStep {
+		int shift;
+		chess::u64 mask;
+	};
+	// Indexed by chess::attackRayDirection
+	constexpr std::array<fillStep, 8> fillSteps { { { 8, chess::constants::bitboardFull }, { 7, notFileA }, { -1, notFileA }, { -9, notFileA }, { -8, chess::constants::bitboardFull }, { -7, notFileH }, { 1, notFileH }, { 9, notFileH } } };
+
+	template <int shift>
+	[[nodiscard]] constexpr chess::u64 shiftBy(const chess::u64 board) noexcept {
+		if constexpr (shift > 0)
+			return board << shift;
+		else
+			return board >> -shift;
+	}
+
+	// Slides the generators along empty squares in 1, 2 and then 4 steps at a time, and one more step onto the attacked squares
+	template <chess::attackRayDirection direction>
+	[[nodiscard]] constexpr chess::u64 occludedFill(chess::u64 generators, chess::u64 empty) noexcept {
+		constexpr fillStep step { fillSteps[direction] };
+		empty &= step.mask;
+		generators |= empty & shiftBy<step.shift>(generators);
+		empty &= shiftBy<step.shift>(empty);
+		generators |= empty & shiftBy<2 * step.shift>(generators);
+		empty &= shiftBy<2 * step.shift>(empty);
+		generators |= empty & shiftBy<4 * step.shift>(generators);
+		return shiftBy<step.shift>(generators) & step.mask;
+	}
+
+	[[nodiscard]] chess::sliders::directionMaps scalarFills(const chess::u64 orthogonalSliders, const chess::u64 diagonalSliders, const chess::u64 occupied) noexcept {
+		return { occludedFill<chess::north>(orthogonalSliders, ~occupied), occludedFill<chess::northEast>(diagonalSliders, ~occupied),
+			     occludedFill<chess::east>(orthogonalSliders, ~occupied), occludedFill<chess::southEast>(diagonalSliders, ~occupied),
+			     occludedFill<chess::south>(orthogonalSliders, ~occupied), occludedFill<chess::southWest>(diagonalSliders, ~occupied),
+			     occludedFill<chess::west>(orthogonalSliders, ~occupied), occludedFill<chess::northWest>(diagonalSliders, ~occupied) };
+	}
+
+#ifdef NMLH_CHESS_AVX2_AVAILABLE
+	// One vector fills north, north east, west and north west (shifting left), the other south, south west, east and south east (shifting right)
+	struct avx2Fill {
+		__m256i towardsA8;
+		__m256i towardsH1;
+	};
+
+	__attribute__((target("avx2"))) inline avx2Fill avx2Fills(const chess::u64 orthogonalSliders, const chess::u64 diagonalSliders, const chess::u64 occupied) noexcept {
+		const __m256i shifts { _mm256_setr_epi64x(8, 7, 1, 9) };
+		const __m256i doubleShifts { _mm256_add_epi64(shifts, shifts) };
+		const __m256i quadrupleShifts { _mm256_add_epi64(doubleShifts, doubleShifts) };
+		const __m256i leftMasks { _mm256_setr_epi64x(static_cast<long long>(chess::constants::bitboardFull), static_cast<long long>(notFileA), static_cast<long long>(notFileH), static_cast<long long>(notFileH)) };
+		const __m256i rightMasks { _mm256_setr_epi64x(static_cast<long long>(chess::constants::bitboardFull), static_cast<long long>(notFileH), static_cast<long long>(notFileA), static_cast<long long>(notFileA)) };
+		const __m256i sliders { _mm256_setr_epi64x(static_cast<long long>(orthogonalSliders), static_cast<long long>(diagonalSliders), static_cast<long long>(orthogonalSliders), static_cast<long long>(diagonalSliders)) };
+		const __m256i empty { _mm256_set1_epi64x(static_cast<long long>(~occupied)) };
+
+		__m256i left { sliders };
+		__m256i right { sliders };
+		__m256i leftEmpty { _mm256_and_si256(empty, leftMasks) };
+		__m256i rightEmpty { _mm256_and_si256(empty, rightMasks) };
+		left       = _mm256_or_si256(left, _mm256_and_si256(leftEmpty, _mm256_sllv_epi64(left, shifts)));
+		right      = _mm256_or_si256(right, _mm256_and_si256(rightEmpty, _mm256_srlv_epi64(right, shifts)));
+		leftEmpty  = _mm256_and_si256(leftEmpty, _mm256_sllv_epi64(leftEmpty, shifts));
+		rightEmpty = _mm256_and_si256(rightEmpty, _mm256_srlv_epi64(rightEmpty, shifts));
+		left       = _mm256_or_si256(left, _mm256_and_si256(leftEmpty, _mm256_sllv_epi64(left, doubleShifts)));
+		right      = _mm256_or_si256(right, _mm256_and_si256(rightEmpty, _mm256_srlv_epi64(right, doubleShifts)));
+		leftEmpty  = _mm256_and_si256(leftEmpty, _mm256_sllv_epi64(leftEmpty, doubleShifts));
+		rightEmpty = _mm256_and_si256(rightEmpty, _mm256_srlv_epi64(rightEmpty, doubleShifts));
+		left       = _mm256_or_si256(left, _mm256_and_si256(leftEmpty, _mm256_sllv_epi64(left, quadrupleShifts)));
+		right      = _mm256_or_si256(right, _mm256_and_si256(rightEmpty, _mm256_srlv_epi64(right, quadrupleShifts)));
+		return { _mm256_and_si256(_mm256_sllv_epi64(left, shifts), leftMasks), _mm256_and_si256(_mm256_srlv_epi64(right, shifts), rightMasks) };
+	}
+
+	__attribute__((target("avx2"))) chess::sliders::directionMaps avx2DirectionalAttacks(const chess::u64 orthogonalSliders, const chess::u64 diagonalSliders, const chess::u64 occupied) noexcept {
+		const avx2Fill fill { avx2Fills(orthogonalSliders, diagonalSliders, occupied) };
+		alignas(32) std::array<chess::u64, 4> towardsA8;
+		alignas(32) std::array<chess::u64, 4> towardsH1;
+		_mm256_store_si256(reinterpret_cast<__m256i*>(towardsA8.data()), fill.towardsA8);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(towardsH1.data()), fill.towardsH1);
+		return { towardsA8[0], towardsA8[1], towardsH1[2], towardsH1[3], towardsH1[0], towardsH1[1], towardsA8[2], towardsA8[3] };
+	}
+
+	__attribute__((target("avx2"))) chess::u64 avx2SetwiseAttacks(const chess::u64 orthogonalSliders, const chess::u64 diagonalSliders, const chess::u64 occupied) noexcept {
+		const avx2Fill fill { avx2Fills(orthogonalSliders, diagonalSliders, occupied) };
+		const __m256i directions { _mm256_or_si256(fill.towardsA8, fill.towardsH1) };
+		const __m128i halves { _mm_or_si128(_mm256_castsi256_si128(directions), _mm256_extracti128_si256(directions, 1)) };
+		return static_cast<chess::u64>(_mm_cvtsi128_si64(_mm_or_si128(halves, _mm_unpackhi_epi64(halves, halves))));
+	}
+#endif
+}    // namespace
+
+#ifdef NMLH_CHESS_PEXT_AVAILABLE
+__attribute__((target("bmi2"))) chess::u64 chess::sliders::pextIndex(const chess::u64 occupied, const chess::u64 mask) noexcept {
+	return _pext_u64(occupied, mask);
+}
+#endif
+
+bool chess::sliders::pextSupported() noexcept {
+#ifdef NMLH_CHESS_PEXT_AVAILABLE
+	return __builtin_cpu_supports("bmi2");
+#else
+	return false;
+#endif
+}
+
+chess::sliders::backend chess::sliders::bestBackend() noexcept {
+	return pextSupported() ? backend::pext : backend::magic;
+}
+
+bool chess::sliders::select(const chess::sliders::backend requestedBackend) noexcept {
+	if (requestedBackend == backend::pext && !pextSupported())
+		return false;
+	activeBackend = requestedBackend;
+	return true;
+}
+
+const char* chess::sliders::name(const chess::sliders::backend targetBackend) noexcept {
+	switch (targetBackend) {
+		case backend::magic:
+			return "magic";
+		case backend::pext:
+			return "pext";
+		default:
+			return "rays";
+	}
+}
+
+
+bool chess::sliders::avx2Supported() noexcept {
+#ifdef NMLH_CHESS_AVX2_AVAILABLE
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
+
+bool chess::sliders::select(const chess::sliders::fillBackend requestedBackend) noexcept {
+	if (requestedBackend == fillBackend::avx2 && !avx2Supported())
+		return false;
+	activeFillBackend = requestedBackend;
+	return true;
+}
+
+const char* chess::sliders::name(const chess::sliders::fillBackend targetBackend) noexcept {
+	return targetBackend == fillBackend::avx2 ? "avx2" : "scalar";
+}
+
+chess::sliders::directionMaps chess::sliders::directionalAttacks(const chess::u64 orthogonalSliders, const chess::u64 diagonalSliders, const chess::u64 occupied) noexcept {
+#ifdef NMLH_CHESS_AVX2_AVAILABLE
+	if (activeFillBackend == fillBackend::avx2)
+		return avx2DirectionalAttacks(orthogonalSliders, diagonalSliders, occupied);
+#endif
+	return scalarFills(orthogonalSliders, diagonalSliders, occupied);
+}
+
+chess::u64 chess::sliders::setwiseAttacks(const chess::u64 orthogonalSliders, const chess::u64 diagonalSliders, const chess::u64 occupied) noexcept {
+#ifdef NMLH_CHESS_AVX2_AVAILABLE
+	if (activeFillBackend == fillBackend::avx2)
+		return avx2SetwiseAttacks(orthogonalSliders, diagonalSliders, occupied);
+#endif
+	chess::u64 result { 0 };
+	for (const chess::u64 directionAttacks : scalarFills(orthogonalSliders, diagonalSliders, occupied)) {
+		result |= directionAttacks;
+	}
+	return result;
+}
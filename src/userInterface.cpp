@@ -146,10 +146,11 @@
 		// Set fullmove number
 		result.fullMoveClock = static_cast<chess::u16>(std::stoul(tokens[5]));
 
-		// Set the zobrist hash of the position]
+		// Set the zobrist hash and evaluation of the position
 		result.bitboards[piece::occupied] = result.bitboards[piece::white] | result.bitboards[piece::black];
 		result.bitboards[piece::empty]    = ~result.bitboards[piece::occupied];
 		result.setZobrist();
+		result.setEvaluation();
 		return result;
 	} else {
 		// Empty position with valid flag not set